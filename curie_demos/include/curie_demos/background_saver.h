@@ -0,0 +1,112 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Writes the experience database to disk on a worker thread so planning is not blocked
+*/
+
+#ifndef CURIE_DEMOS_BACKGROUND_SAVER_H
+#define CURIE_DEMOS_BACKGROUND_SAVER_H
+
+// C++
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// OMPL
+#include <ompl/tools/experience/ExperienceSetup.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Moves the (slow) saveIfChanged() call of an experience database off of the main thread.
+ *        The database must not be modified while a save is in progress - callers are expected to
+ *        call waitUntilIdle() before any operation that adds to or removes from the graph
+ */
+class BackgroundSaver
+{
+public:
+  /** \brief Constructor */
+  BackgroundSaver(ompl::tools::ExperienceSetupPtr experience_setup);
+
+  /** \brief Destructor - finishes any pending save before returning */
+  ~BackgroundSaver();
+
+  /** \brief Queue a save of the database and return immediately. Multiple requests made while a
+   *         save is in progress are merged into a single follow-up save */
+  void requestSave();
+
+  /** \brief Block until no save is pending or in progress */
+  void waitUntilIdle();
+
+  /** \brief Returns true if a save is pending or currently being written */
+  bool isBusy();
+
+  /** \brief Number of saves that have been written so far */
+  std::size_t getNumSaves()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return num_saves_;
+  }
+
+private:
+  /** \brief Worker thread main loop */
+  void saveThread();
+
+  // The short name of this class
+  std::string name_ = "background_saver";
+
+  // Database to persist
+  ompl::tools::ExperienceSetupPtr experience_setup_;
+
+  // Worker thread
+  std::thread thread_;
+
+  // Protects all of the flags below
+  std::mutex mutex_;
+  std::condition_variable condition_;
+
+  bool save_requested_ = false;
+  bool saving_ = false;
+  bool shutdown_ = false;
+  std::size_t num_saves_ = 0;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<BackgroundSaver> BackgroundSaverPtr;
+typedef boost::shared_ptr<const BackgroundSaver> BackgroundSaverConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_BACKGROUND_SAVER_H
@@ -0,0 +1,182 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Generate valid robot states in batches, rejecting samples with the cheapest checks first
+*/
+
+#ifndef CURIE_DEMOS_BATCH_STATE_SAMPLER_H
+#define CURIE_DEMOS_BATCH_STATE_SAMPLER_H
+
+// C++
+#include <vector>
+
+// MoveIt
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/robot_state.h>
+
+// OMPL
+#include <ompl/base/State.h>
+#include <moveit_ompl/model_based_state_space.h>
+
+// Random
+#include <random_numbers/random_numbers.h>
+
+// this package
+#include <curie_demos/memory_usage.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Draws many joint vectors at once into a structure-of-arrays buffer, filters them through a cascade
+ *        of increasingly expensive checks, and keeps the survivors in a reservoir of pre-validated states.
+ *        Forward kinematics is computed once per candidate, which then goes through state feasibility, self
+ *        collision and collision with the world, stopping at the first check that rejects it.
+ *        Not thread safe - use one instance per thread.
+ */
+class BatchStateSampler
+{
+public:
+  /**
+   * \brief Constructor
+   * \param space - the state space whose joint model group is sampled
+   * \param planning_scene - the environment to check against
+   * \param robot_state - template for the joints that are not part of the group
+   * \param seed - seed of this sampler's random stream
+   * \param group_name - links to collision check, empty to check the whole robot
+   * \param batch_size - number of samples drawn at once
+   */
+  BatchStateSampler(moveit_ompl::ModelBasedStateSpacePtr space, planning_scene::PlanningSceneConstPtr planning_scene,
+                    const moveit::core::RobotState &robot_state, boost::uint32_t seed,
+                    const std::string &group_name = "", std::size_t batch_size = 128);
+
+  /**
+   * \brief Get a valid state from the reservoir, drawing more batches if it is empty
+   * \return false if no valid state could be found within the batch limit
+   */
+  bool sample(moveit::core::RobotState &robot_state);
+  bool sample(ompl::base::State *state);
+  bool sample(double *values);
+
+  /**
+   * \brief Top up the reservoir so that it holds at least num_states valid states
+   * \return false if the batch limit was reached first
+   */
+  bool fill(std::size_t num_states);
+
+  /** \brief Number of pre-validated states waiting in the reservoir */
+  std::size_t getReservoirSize() const
+  {
+    return reservoir_.size() / dim_;
+  }
+
+  /** \brief Maximum number of consecutive batches without any valid state before sample() fails */
+  void setMaxEmptyBatches(std::size_t max_empty_batches)
+  {
+    max_empty_batches_ = max_empty_batches;
+  }
+
+  /** \brief Log when no valid state is found, on by default. Callers that retry report failures themselves */
+  void setVerbose(bool verbose)
+  {
+    verbose_ = verbose;
+  }
+
+  /** \brief Debugging mode that accepts every sample */
+  void setCheckingEnabled(bool checking_enabled)
+  {
+    checking_enabled_ = checking_enabled;
+  }
+
+  /** \brief Fraction of all drawn samples that turned out valid */
+  double getAcceptanceRate() const;
+
+  /** \brief Output the per-stage rejection counts */
+  void printStats() const;
+
+private:
+  /** \brief Draw a batch, filter it, and append the survivors to the reservoir. Returns number added */
+  std::size_t sampleBatch();
+
+  /** \brief Load sample i of the batch buffer into the scratch robot state and compute its transforms */
+  void loadSample(std::size_t i);
+
+  // The short name of this class
+  std::string name_ = "batch_state_sampler";
+
+  // Environment
+  moveit_ompl::ModelBasedStateSpacePtr space_;
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+  const moveit::core::JointModelGroup *jmg_;
+  moveit::core::RobotState robot_state_;
+  random_numbers::RandomNumberGenerator rng_;
+
+  // Collision settings
+  collision_detection::CollisionRequest collision_request_;
+  bool checking_enabled_ = true;
+  bool verbose_ = true;
+
+  // Sampling bounds of each variable in the group
+  std::vector<double> min_position_;
+  std::vector<double> max_position_;
+
+  // Sizes
+  std::size_t dim_;
+  std::size_t batch_size_;
+  std::size_t max_empty_batches_ = 8;
+
+  // Batch buffer, dimension-major: batch_[d * batch_size_ + i] is variable d of sample i
+  std::vector<double, CountingAllocator<double, MEMORY_SPARSE_SAMPLING>> batch_;
+  // Indices of samples in the batch that are still candidates
+  std::vector<std::size_t> survivors_;
+  // Scratch for one sample in group order
+  std::vector<double> sample_values_;
+
+  // Valid states, row-major, dim_ values each
+  std::vector<double, CountingAllocator<double, MEMORY_SPARSE_SAMPLING>> reservoir_;
+
+  // Statistics
+  std::size_t num_drawn_ = 0;
+  std::size_t num_rejected_world_ = 0;
+  std::size_t num_rejected_self_ = 0;
+  std::size_t num_rejected_feasibility_ = 0;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<BatchStateSampler> BatchStateSamplerPtr;
+typedef boost::shared_ptr<const BatchStateSampler> BatchStateSamplerConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_BATCH_STATE_SAMPLER_H
@@ -62,11 +62,36 @@
 // this package
 #include <moveit_visual_tools/imarker_robot_state.h>
 #include <curie_demos/tolerances.h>
+#include <curie_demos/joint_pose_arena.h>
+#include <curie_demos/joint_velocity_filter.h>
+#include <curie_demos/layered_path_solver.h>
 
 namespace curie_demos
 {
 class CurieDemos;
 
+/** \brief Wall time in seconds and size of each stage of Cartesian graph generation, summed until resetStats() */
+struct CartGraphStats
+{
+  double transform_path_time_ = 0;      // transform2DPath()
+  double compute_poses_time_ = 0;       // computeAllPoses()
+  double ik_time_ = 0;                  // getAllIK() of every candidate pose
+  double add_vertices_time_ = 0;        // addCartPointToBoltGraph()
+  double add_edges_time_ = 0;           // addEdgesToBoltGraph()
+  double solve_layers_time_ = 0;        // solveCartesianLayers()
+  double connect_end_points_time_ = 0;  // connectTrajectoryEndPoints()
+  double total_time_ = 0;               // populateBoltGraph()
+
+  std::size_t num_points_ = 0;
+  std::size_t num_candidate_poses_ = 0;
+  std::size_t num_vertices_ = 0;
+  std::size_t num_edges_ = 0;
+  std::size_t num_edges_skipped_ = 0;
+
+  // Memory held for the IK solutions of all points
+  std::size_t ik_buffer_bytes_ = 0;
+};
+
 class CartPathPlanner
 {
 public:
@@ -90,7 +115,7 @@ public:
                     EigenSTL::vector_Affine3d& candidate_poses);
   bool transform2DPath(const Eigen::Affine3d& starting_pose, EigenSTL::vector_Affine3d& poses);
   bool populateBoltGraph(ompl::tools::bolt::TaskGraphPtr task_graph);
-  bool addCartPointToBoltGraph(const std::vector<std::vector<double>>& joint_poses,
+  bool addCartPointToBoltGraph(const JointPoseLayer& joint_poses,
                                std::vector<ompl::tools::bolt::TaskVertex>& point_vertices,
                                moveit::core::RobotStatePtr moveit_robot_state);
   bool addEdgesToBoltGraph(const TrajectoryGraph& graph_vertices, ompl::tools::bolt::TaskVertex startingVertex,
@@ -99,6 +124,40 @@ public:
   bool getAllJointPosesForCartPoint(const Eigen::Affine3d& pose, std::vector<std::vector<double>>& joint_poses);
   void visualizeAllJointPoses(const std::vector<std::vector<double>>& joint_poses);
 
+  /** \brief Compute the exact cheapest path across the Cartesian points from every start vertex, using the
+   *         edges created by addEdgesToBoltGraph() and its velocity filter masks */
+  bool solveCartesianLayers();
+
+  /** \brief Pose of the end effector at the interactive marker, where the path starts */
+  Eigen::Affine3d getStartPose();
+
+  /** \brief Change the discretization of the orientation tolerance, the IK solutions are recomputed */
+  void setOrientationIncrement(double orientation_increment);
+
+  double getOrientationIncrement() const
+  {
+    return orientation_increment_;
+  }
+
+  /** \brief Change the orientation tolerance of every point, the IK solutions are recomputed */
+  void setOrientationTol(const OrientationTol& orientation_tol);
+
+  const OrientationTol& getOrientationTol() const
+  {
+    return orientation_tol_;
+  }
+
+  /** \brief Timing and size of graph generation since the last resetStats() */
+  const CartGraphStats& getStats() const
+  {
+    return stats_;
+  }
+
+  void resetStats()
+  {
+    stats_ = CartGraphStats();
+  }
+
 private:
   // --------------------------------------------------------
 
@@ -136,6 +195,28 @@ private:
   // Timing between each pose in exact_poses
   double timing_;
 
+  // Solvable joint poses for each point in exact_poses_, kept until the poses change
+  std::vector<JointPoseLayer> layer_joint_poses_;
+
+  // Storage for layer_joint_poses_
+  JointPoseArenaPtr joint_pose_arena_;
+
+  // Removes edges that would exceed joint velocity limits
+  JointVelocityFilterPtr velocity_filter_;
+
+  // Task graph vertices of the current Cartesian graph, by point then pose
+  TrajectoryGraph graph_vertices_;
+
+  // Velocity filter result of every Cartesian edge, by point then pose at that point, one bit per pose at the
+  // previous point
+  std::vector<std::vector<std::vector<uint64_t>>> feasible_moves_;
+
+  // Exact costs across the Cartesian graph
+  LayeredPathSolverPtr layered_solver_;
+
+  // Timing of each stage
+  CartGraphStats stats_;
+
   // User settings
   bool descartes_check_collisions_;
 
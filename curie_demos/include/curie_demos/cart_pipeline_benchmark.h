@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Time each stage of Cartesian graph generation over offsets of the Cartesian path and tolerances
+*/
+
+#ifndef CURIE_DEMOS_CART_PIPELINE_BENCHMARK_H
+#define CURIE_DEMOS_CART_PIPELINE_BENCHMARK_H
+
+// C++
+#include <fstream>
+#include <string>
+#include <vector>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/cart_path_planner.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Runs populateBoltGraph() for every combination of path start offset, orientation increment and
+ *        orientation tolerance listed in the cart_pipeline_benchmark rosparams, several times each, and writes
+ *        the time of each stage, the graph size and the bytes held by each MemoryTracker subsystem to a CSV file
+ *        for tracking regressions. Every offset moves the same Cartesian path, loaded from 2d_path.csv
+ */
+class CartPipelineBenchmark
+{
+public:
+  /** \brief Constructor */
+  CartPipelineBenchmark(CartPathPlannerPtr cart_path_planner, ompl::tools::bolt::TaskGraphPtr task_graph);
+
+  /** \brief Run every combination and write the results */
+  bool run();
+
+private:
+  /** \brief Generate the graph once and add its row to the CSV */
+  void runOnce(std::size_t path_id, const Eigen::Affine3d& start_pose, std::size_t repetition);
+
+  // The short name of this class
+  std::string name_ = "cart_pipeline_benchmark";
+
+  // A shared node handle
+  ros::NodeHandle nh_;
+
+  CartPathPlannerPtr cart_path_planner_;
+  ompl::tools::bolt::TaskGraphPtr task_graph_;
+
+  // Settings, the lists hold x, y, z triples
+  std::vector<double> path_offsets_;
+  std::vector<double> orientation_increments_;
+  std::vector<double> orientation_tolerances_;
+  int repetitions_;
+  std::string output_file_;
+
+  std::ofstream output_;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<CartPipelineBenchmark> CartPipelineBenchmarkPtr;
+typedef boost::shared_ptr<const CartPipelineBenchmark> CartPipelineBenchmarkConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_CART_PIPELINE_BENCHMARK_H
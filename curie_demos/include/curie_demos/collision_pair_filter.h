@@ -0,0 +1,77 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Skip collision pairs that cannot change while only one planning group moves
+*/
+
+#ifndef CURIE_DEMOS_COLLISION_PAIR_FILTER_H
+#define CURIE_DEMOS_COLLISION_PAIR_FILTER_H
+
+// C++
+#include <string>
+
+// MoveIt
+#include <moveit/collision_detection/collision_matrix.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/robot_state.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Get the joint that moves a link when only the joints of jmg change, i.e. the nearest non-fixed ancestor
+ *        joint that belongs to the group. Links with the same moving joint keep their relative pose in every
+ *        state of the group
+ * \return NULL for links that do not move with the group
+ */
+const moveit::core::JointModel* getGroupParentJoint(const moveit::core::LinkModel* link,
+                                                    const moveit::core::JointModelGroup* jmg);
+
+/**
+ * \brief Allow collisions between every pair of bodies that move rigidly together when only the joints of
+ *        group_name change and the rest of the robot stays at reference_state: links on the same moving joint,
+ *        links that do not move at all, and those links against the (static) world objects. The result of such
+ *        a pair is the same for every state, so it is decided once here rather than by the narrow phase of every
+ *        check. Pairs in collision at reference_state are left as they are, so those states still report them
+ * \param scene - environment to filter against, its world must not change afterwards
+ * \param acm - matrix to add the allowed pairs to, usually a copy of the scene's
+ * \return number of pairs newly allowed
+ */
+std::size_t filterGroupCollisionPairs(const planning_scene::PlanningScene& scene, const std::string& group_name,
+                                      const moveit::core::RobotState& reference_state,
+                                      collision_detection::AllowedCollisionMatrix& acm);
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_COLLISION_PAIR_FILTER_H
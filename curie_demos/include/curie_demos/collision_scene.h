@@ -0,0 +1,77 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Build the static environment of the workcell and the scene that collision checks are run against
+*/
+
+#ifndef CURIE_DEMOS_COLLISION_SCENE_H
+#define CURIE_DEMOS_COLLISION_SCENE_H
+
+// C++
+#include <string>
+
+// Boost
+#include <boost/cstdint.hpp>
+
+// MoveIt
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Add the floor and wall of the workcell to the monitored scene, and get the scene to check collisions
+ *        against
+ * \param planning_scene_monitor - owner of the scene displayed in Rviz
+ * \param group_name - the only group that moves during collision checks
+ * \param reference_state - values of the joints outside the group during collision checks
+ * \param freeze - return a standalone copy that nothing else writes to, instead of the monitored scene itself.
+ *                 Required if the scene is read from more than one thread, the monitored scene is read unlocked
+ * \param filter_collision_pairs - when frozen, skip pairs that cannot change while only the group moves
+ * \param self_collision_samples - when frozen, states sampled to find self collision pairs that always or never
+ *                                 collide, cached in ros/ompl_storage. 0 disables
+ * \param seed - of the self collision sampling
+ * \param validation_scene - if given, set to the scene to validate solutions against. The same as the returned
+ *                           scene, except that the sampled self collision pairs are still checked, as sampling
+ *                           does not prove a pair always or never collides
+ */
+planning_scene::PlanningSceneConstPtr
+createCollisionScene(const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor,
+                     const std::string& group_name, const moveit::core::RobotState& reference_state, bool freeze,
+                     bool filter_collision_pairs, std::size_t self_collision_samples, boost::uint32_t seed,
+                     planning_scene::PlanningSceneConstPtr* validation_scene = nullptr);
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_COLLISION_SCENE_H
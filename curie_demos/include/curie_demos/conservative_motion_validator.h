@@ -0,0 +1,151 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Motion validator that uses obstacle clearance to take large steps along an edge
+*/
+
+#ifndef CURIE_DEMOS_CONSERVATIVE_MOTION_VALIDATOR_H
+#define CURIE_DEMOS_CONSERVATIVE_MOTION_VALIDATOR_H
+
+// C++
+#include <atomic>
+#include <vector>
+
+// MoveIt
+#include <moveit/planning_scene/planning_scene.h>
+
+// OMPL
+#include <ompl/base/MotionValidator.h>
+#include <ompl/base/SpaceInformation.h>
+#include <moveit_ompl/model_based_state_space.h>
+#include <moveit_ompl/detail/threadsafe_state_storage.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Checks an edge using conservative advancement instead of fixed resolution discretization.
+ *        Each state along the edge is checked the same way as moveit_ompl::StateValidityChecker, but the
+ *        distance to the world d_w and the self collision distance d_s are computed separately, as a combined
+ *        check reports only one of them. No point on the robot can move further than sum(L_j * |dq_j|) for a
+ *        joint motion dq, where the Lipschitz bound L_j is the distance from joint j to the furthest point of
+ *        geometry it moves. Against the static world that is the closing distance, while two links of the
+ *        robot can close at up to twice that, so the next min(d_w, d_s / 2) / sum(L_j * |dq_j|) fraction of the
+ *        edge is skipped. This relies on the distances reported by the collision checker being lower bounds.
+ *        Far from obstacles an edge is certified in a few checks; near obstacles the step never drops below
+ *        the space's state validity checking resolution, i.e. the same as OMPL's DiscreteMotionValidator.
+ *        The bounds do not include attached objects, so a state with any attached body falls back to the
+ *        minimum step
+ */
+class ConservativeMotionValidator : public ompl::base::MotionValidator
+{
+public:
+  /** \brief Constructor */
+  ConservativeMotionValidator(const ompl::base::SpaceInformationPtr &si, moveit_ompl::ModelBasedStateSpacePtr space,
+                              planning_scene::PlanningSceneConstPtr planning_scene);
+
+  /** \brief Check if the path between two states is valid. s1 is assumed valid */
+  virtual bool checkMotion(const ompl::base::State *s1, const ompl::base::State *s2) const;
+
+  /** \brief Check if the path between two states is valid, also returning the last valid state */
+  virtual bool checkMotion(const ompl::base::State *s1, const ompl::base::State *s2,
+                           std::pair<ompl::base::State *, double> &last_valid) const;
+
+  /** \brief Get the largest distance any point on the robot can move per unit of motion of each joint */
+  const std::vector<double> &getLipschitzBounds() const
+  {
+    return lipschitz_bounds_;
+  }
+
+  /** \brief Total number of validity checks done, for comparing against discrete checking */
+  std::size_t getNumChecks() const
+  {
+    return num_checks_.load();
+  }
+
+private:
+  /** \brief Compute the per joint Lipschitz bounds from the kinematic chain and collision geometry */
+  void computeLipschitzBounds();
+
+  /** \brief Distance from the origin of link to the furthest point of its, and its descendants', geometry. Only
+   *         the robot model's links, attached bodies are not included */
+  double getDescendantExtent(const moveit::core::LinkModel *link) const;
+
+  /**
+   * \brief Check a state for validity and measure its clearance
+   * \param world_distance - distance between the robot and the world, when valid
+   * \param self_distance - distance between links of the robot that may collide, when valid
+   * \param has_attached_bodies - whether objects are attached to the robot, which the bounds do not cover
+   */
+  bool checkState(const ompl::base::State *state, double &world_distance, double &self_distance,
+                  bool &has_attached_bodies) const;
+
+  /** \brief Workspace distance that any point of the robot may travel while moving from s1 to s2 */
+  double getMaxDisplacement(const ompl::base::State *s1, const ompl::base::State *s2) const;
+
+  /** \brief Implementation of both checkMotion() variants */
+  bool checkMotionImpl(const ompl::base::State *s1, const ompl::base::State *s2,
+                       std::pair<ompl::base::State *, double> *last_valid) const;
+
+  // The short name of this class
+  std::string name_ = "conservative_motion_validator";
+
+  moveit_ompl::ModelBasedStateSpacePtr space_;
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+
+  // A robot state per thread for checking
+  moveit_ompl::TSStateStorage tss_;
+  collision_detection::CollisionRequest distance_request_;
+
+  // For each active joint, its index in the state's values
+  std::vector<std::size_t> joint_variable_index_;
+  std::vector<const moveit::core::JointModel *> joints_;
+
+  // For each active joint, largest distance any point moves per unit of its motion
+  std::vector<double> lipschitz_bounds_;
+
+  // False if the group has joints that are not handled, in which case only discrete checking is done
+  bool supported_ = true;
+
+  // Edges may be checked from several threads
+  mutable std::atomic<std::size_t> num_checks_;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<ConservativeMotionValidator> ConservativeMotionValidatorPtr;
+typedef boost::shared_ptr<const ConservativeMotionValidator> ConservativeMotionValidatorConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_CONSERVATIVE_MOTION_VALIDATOR_H
@@ -58,9 +58,20 @@
 #include <ompl_visual_tools/moveit_viz_window.h>
 
 // this package
-//#include <curie_demos/process_mem_usage.h>
+#include <curie_demos/memory_usage.h>
+#include <curie_demos/trace.h>
+#include <curie_demos/metrics_publisher.h>
 #include <curie_demos/state_validity_checker.h>
 #include <curie_demos/cart_path_planner.h>
+#include <curie_demos/cart_pipeline_benchmark.h>
+#include <curie_demos/background_saver.h>
+#include <curie_demos/parallel_valid_state_sampler.h>
+#include <curie_demos/batch_state_sampler.h>
+#include <curie_demos/state_reservoir.h>
+#include <curie_demos/random_streams.h>
+#include <curie_demos/conservative_motion_validator.h>
+#include <curie_demos/path_validator.h>
+#include <curie_demos/collision_scene.h>
 #include <moveit_visual_tools/imarker_robot_state.h>
 
 namespace mo = moveit_ompl;
@@ -82,8 +93,14 @@ public:
   /** \brief Generate states for testing */
   void testConnectionToGraphOfRandStates();
 
+  /** \brief Add the floor and wall, then freeze the scene and filter its collision pairs if requested */
+  void loadStaticEnvironment();
+
   void loadCollisionChecker();
 
+  /** \brief Start the background producers of valid states, and use them for roadmap sampling */
+  void loadStateReservoir();
+
   bool loadData();
 
   void run();
@@ -95,8 +112,15 @@ public:
   /** \brief Create multiple dummy cartesian paths */
   bool generateCartGraph();
 
+  /** \brief Start checking a solution on worker threads, the result is reported by waitForPathCheck() */
   bool checkOMPLPathSolution(og::PathGeometric& path);
-  bool checkMoveItPathSolution(robot_trajectory::RobotTrajectoryPtr traj);
+
+  /** \brief Block until the last solution check finishes and explain any invalid states */
+  bool waitForPathCheck();
+
+  /** \brief Log the contacts of invalid states and display them in Rviz */
+  bool explainInvalidStates(const std::vector<std::size_t>& index, std::size_t state_count,
+                            const std::function<void(std::size_t, moveit::core::RobotState&)>& get_state);
 
   bool getRandomState(moveit::core::RobotStatePtr& robot_state);
 
@@ -117,6 +141,15 @@ public:
 
   void testMotionValidator();
 
+  /** \brief Write the database to file, on a worker thread if background saving is enabled */
+  void saveDatabase();
+
+  /** \brief Block until any background save has finished - call before modifying the database */
+  void waitForDatabaseSave();
+
+  /** \brief Write the trace events recorded so far, if tracing is enabled */
+  void saveTrace();
+
   // --------------------------------------------------------
 
   // A shared node handle
@@ -135,6 +168,12 @@ public:
   ompl::tools::ExperienceSetupPtr experience_setup_;
   ompl::tools::bolt::BoltPtr bolt_;
 
+  // Reports the metrics registry while running
+  MetricsPublisherPtr metrics_publisher_;
+
+  // Writes the database to file without blocking planning
+  BackgroundSaverPtr background_saver_;
+
   // Configuration space
   moveit_ompl::ModelBasedStateSpacePtr space_;
   ompl::base::SpaceInformationPtr si_;
@@ -171,6 +210,7 @@ public:
   bool check_valid_vertices_;
   bool display_disjoint_sets_;
   bool benchmark_performance_;
+  bool benchmark_cartesian_ = false;
   bool post_processing_;
   int post_processing_interval_;
 
@@ -186,8 +226,27 @@ public:
   bool headless_;
   bool auto_run_;
   bool track_memory_consumption_ = false;
+  bool record_trace_ = false;
+  double metrics_period_ = 0.0;
   bool use_logging_ = false;
   bool collision_checking_enabled_ = true;
+  bool background_save_ = true;
+  int sampling_threads_ = 0;
+  int reservoir_max_failed_attempts_ = 0;
+  bool continuous_motion_validation_ = true;
+  bool freeze_planning_scene_ = true;
+  bool filter_collision_pairs_ = true;
+  int self_collision_samples_ = 0;
+
+  // Every random number used by the program is derived from this
+  boost::uint32_t master_seed_ = 0;
+  boost::shared_ptr<random_numbers::RandomNumberGenerator> rng_;
+
+  // Reservoir of pre-validated random states for testing, checked against the whole robot
+  BatchStateSamplerPtr random_state_sampler_;
+
+  // Valid states for the planning group, produced in the background for roadmap and problem generation
+  StateReservoirPtr state_reservoir_;
 
   // Verbosity levels
   bool debug_print_trajectory_;
@@ -215,8 +274,20 @@ public:
   moveit_visual_tools::IMarkerRobotStatePtr imarker_start_;
   moveit_visual_tools::IMarkerRobotStatePtr imarker_goal_;
 
+  // Scene used by every collision check - an immutable copy of planning_scene_ when frozen
+  planning_scene::PlanningSceneConstPtr collision_scene_;
+
+  // Scene solutions are validated against - collision_scene_ without the sampled self collision pairs
+  planning_scene::PlanningSceneConstPtr validation_scene_;
+
   // Validity checker
   moveit_ompl::StateValidityChecker* validity_checker_;
+
+  // Checks solution trajectories in parallel with planning
+  PathValidatorPtr path_validator_;
+
+  // Edge checker using the validity checker's clearance
+  ConservativeMotionValidatorPtr motion_validator_;
 };  // end class
 
 // Create boost pointers for this class
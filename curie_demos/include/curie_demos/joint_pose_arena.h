@@ -0,0 +1,134 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Contiguous storage for the joint solutions of every Cartesian point, released all at once
+*/
+
+#ifndef CURIE_DEMOS_JOINT_POSE_ARENA_H
+#define CURIE_DEMOS_JOINT_POSE_ARENA_H
+
+// C++
+#include <memory>
+#include <vector>
+
+// Boost
+#include <boost/shared_ptr.hpp>
+
+namespace curie_demos
+{
+/**
+ * \brief The joint solutions of one Cartesian point in a JointPoseArena. Stored twice: row-major, one pose after
+ *        another, for converting to states, and dimension-major, each joint's values across all poses, for
+ *        passes that compare one pose against the whole layer
+ */
+struct JointPoseLayer
+{
+  /** \brief Get the joint values of one solution */
+  const double* getPose(std::size_t pose_id) const
+  {
+    return poses_ + pose_id * dim_;
+  }
+
+  /** \brief Get the values of one joint across all solutions */
+  const double* getJoint(std::size_t joint_id) const
+  {
+    return joints_ + joint_id * num_poses_;
+  }
+
+  double* poses_ = nullptr;
+  double* joints_ = nullptr;
+  std::size_t num_poses_ = 0;
+  std::size_t dim_ = 0;
+};
+
+/**
+ * \brief Bump allocator for joint poses. Each layer is one contiguous block carved from large slabs, so the
+ *        solutions of neighboring Cartesian points sit next to each other for the edge loops. Nothing is freed
+ *        individually: reset() makes all the slabs available again for the next set of poses without returning
+ *        them to the heap
+ */
+class JointPoseArena
+{
+public:
+  /** \brief Constructor */
+  JointPoseArena(std::size_t dim, std::size_t slab_poses = 4096);
+
+  /** \brief Destructor */
+  ~JointPoseArena();
+
+  /** \brief Allocate a layer of num_poses solutions. Invalidated by reset() */
+  JointPoseLayer allocate(std::size_t num_poses);
+
+  /** \brief Copy solutions, e.g. from IK, into a new layer, filling both layouts */
+  JointPoseLayer copy(const std::vector<std::vector<double>>& joint_poses);
+
+  /** \brief Release all layers at once, keeping the memory for reuse */
+  void reset();
+
+  /** \brief Number of poses currently allocated */
+  std::size_t getNumPoses() const
+  {
+    return num_poses_;
+  }
+
+  /** \brief Memory held by the slabs, in bytes */
+  std::size_t getCapacityBytes() const;
+
+private:
+  struct Slab
+  {
+    std::unique_ptr<double[]> data_;
+    std::size_t capacity_;  // in poses
+  };
+
+  std::size_t dim_;
+  std::size_t slab_poses_;
+
+  std::vector<Slab> slabs_;
+
+  // Next free pose in the current slab
+  std::size_t slab_id_ = 0;
+  std::size_t slab_offset_ = 0;
+
+  std::size_t num_poses_ = 0;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<JointPoseArena> JointPoseArenaPtr;
+typedef boost::shared_ptr<const JointPoseArena> JointPoseArenaConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_JOINT_POSE_ARENA_H
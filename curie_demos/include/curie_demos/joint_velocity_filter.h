@@ -0,0 +1,97 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Joint velocity feasibility between neighboring Cartesian points, one pose against a whole layer
+*/
+
+#ifndef CURIE_DEMOS_JOINT_VELOCITY_FILTER_H
+#define CURIE_DEMOS_JOINT_VELOCITY_FILTER_H
+
+// C++
+#include <cstdint>
+#include <vector>
+
+// MoveIt
+#include <moveit/robot_model/joint_model_group.h>
+
+// this package
+#include <curie_demos/joint_pose_arena.h>
+
+namespace curie_demos
+{
+/**
+ * \brief The same test as Descartes' isValidMove(): every joint must be able to cover its change in position
+ *        within the time between two Cartesian points without exceeding its velocity limit. Joints without
+ *        a velocity limit are not restricted. Instead of one virtual call per pair of poses, a pose is tested
+ *        against a whole layer at once over the layer's dimension-major storage, several poses per SIMD
+ *        instruction (AVX or SSE2, whichever the compiler is targeting, else scalar)
+ */
+class JointVelocityFilter
+{
+public:
+  /** \brief Constructor */
+  JointVelocityFilter(const moveit::core::JointModelGroup* jmg, double timing);
+
+  /** \brief Check a single pair of poses */
+  bool isValidMove(const double* from_pose, const double* to_pose) const;
+
+  /**
+   * \brief Check a pose against every pose in a layer
+   * \param feasible - bitmask with bit i set if the move to/from pose i of the layer is possible
+   * \return number of feasible moves
+   */
+  std::size_t filterLayer(const JointPoseLayer& layer, const double* pose, std::vector<uint64_t>& feasible) const;
+
+  /** \brief Read one bit of the mask computed by filterLayer() */
+  static bool isFeasible(const std::vector<uint64_t>& feasible, std::size_t pose_id)
+  {
+    return (feasible[pose_id >> 6] >> (pose_id & 63)) & 1;
+  }
+
+private:
+  // The short name of this class
+  std::string name_ = "joint_velocity_filter";
+
+  // Furthest each joint can move between two Cartesian points
+  std::vector<double> max_motion_;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<JointVelocityFilter> JointVelocityFilterPtr;
+typedef boost::shared_ptr<const JointVelocityFilter> JointVelocityFilterConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_JOINT_VELOCITY_FILTER_H
@@ -0,0 +1,108 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Dynamic programming over the layers of a Cartesian path
+*/
+
+#ifndef CURIE_DEMOS_LAYERED_PATH_SOLVER_H
+#define CURIE_DEMOS_LAYERED_PATH_SOLVER_H
+
+// C++
+#include <functional>
+#include <string>
+#include <vector>
+
+// Boost
+#include <boost/shared_ptr.hpp>
+
+// this package
+#include <curie_demos/memory_usage.h>
+
+namespace curie_demos
+{
+/**
+ * \brief The Cartesian part of the task graph is a layered DAG - one layer of joint solutions per Cartesian point,
+ *        with edges only between consecutive layers. Instead of general graph search, a single Viterbi style
+ *        sweep from the last layer back to the first gives the exact cheapest cost from every vertex to the end
+ *        of the path. Only two layers of costs are held during the sweep, and the costs of the first layer are kept
+ */
+class LayeredPathSolver
+{
+public:
+  /** \brief Cost of the edge from pose0 in layer traj_id - 1 to pose1 in layer traj_id, infinity if there is no
+   *         edge */
+  typedef std::function<double(std::size_t traj_id, std::size_t pose0, std::size_t pose1)> TransitionCost;
+
+  /** \brief Constructor */
+  LayeredPathSolver();
+
+  /**
+   * \brief Run the sweep
+   * \param layer_sizes - number of poses in each layer
+   * \return true if at least one start vertex can reach the last layer
+   */
+  bool solve(const std::vector<std::size_t>& layer_sizes, const TransitionCost& transition_cost);
+
+  /** \brief Exact cost from a start vertex (pose of the first layer) to the last layer, infinity if unreachable */
+  double getStartCost(std::size_t pose_id) const
+  {
+    return start_cost_[pose_id];
+  }
+
+  /** \brief Cheapest cost across the whole Cartesian path, over all start vertices */
+  double getShortestCost() const
+  {
+    return shortest_cost_;
+  }
+
+private:
+  // The short name of this class
+  std::string name_ = "layered_path_solver";
+
+  typedef std::vector<double, CountingAllocator<double, MEMORY_TASK_GRAPH>> CostLayer;
+
+  // Cost to the last layer of every pose of the first layer
+  CostLayer start_cost_;
+
+  double shortest_cost_;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<LayeredPathSolver> LayeredPathSolverPtr;
+typedef boost::shared_ptr<const LayeredPathSolver> LayeredPathSolverConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_LAYERED_PATH_SOLVER_H
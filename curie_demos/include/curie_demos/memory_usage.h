@@ -0,0 +1,161 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Cheap process memory readings and per subsystem allocation accounting
+*/
+
+#ifndef CURIE_DEMOS_MEMORY_USAGE_H
+#define CURIE_DEMOS_MEMORY_USAGE_H
+
+// C++
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace curie_demos
+{
+/**
+ * \brief Read the virtual memory size and resident set size of this process from /proc/self/statm, a single
+ *        line of page counts
+ *        Resident Set Size - this is the combined 'Shared Memory' and 'Memory' in the system monitor
+ * \return false on failure, in which case both are 0.0. Results are in MB
+ */
+bool getMemoryUsage(double& vm_usage, double& resident_set);
+
+/** \brief Parts of this package whose allocations are counted. Memory held by Bolt and the visual tools is not
+ *         allocated here, and is measured by the RSS change of the phase that creates it */
+enum MemorySubsystem
+{
+  MEMORY_SPARSE_SAMPLING,  // valid state batches and reservoirs that feed sparse graph generation
+  MEMORY_TASK_GRAPH,       // Cartesian graph bookkeeping, e.g. start costs of the layered solver
+  MEMORY_IK_BUFFERS,       // joint solutions of every Cartesian point
+  MEMORY_ROADMAP_STATES,   // joint values of roadmap vertices kept in a RoadmapStateStore
+  MEMORY_NUM_SUBSYSTEMS
+};
+
+/**
+ * \brief Process wide counters of the bytes currently allocated by each subsystem and their peaks, plus a list of
+ *        named phases recording the RSS and subsystem peaks over each phase for a summary at the end of a run.
+ *        Counting is lock free and always on, phases are only recorded when enabled
+ */
+class MemoryTracker
+{
+public:
+  /** \brief Count an allocation */
+  static void recordAllocation(MemorySubsystem subsystem, std::size_t bytes);
+
+  /** \brief Count a deallocation */
+  static void recordDeallocation(MemorySubsystem subsystem, std::size_t bytes);
+
+  /** \brief Bytes currently allocated by a subsystem */
+  static std::size_t getCurrentBytes(MemorySubsystem subsystem);
+
+  /** \brief Most bytes allocated at once by a subsystem since the current phase began */
+  static std::size_t getPeakBytes(MemorySubsystem subsystem);
+
+  /** \brief Record phases, off by default */
+  static void setEnabled(bool enabled);
+
+  static bool isEnabled();
+
+  /** \brief Start a named phase, ending any phase in progress */
+  static void beginPhase(const std::string& name);
+
+  /** \brief End the phase in progress */
+  static void endPhase();
+
+  /** \brief Log every recorded phase and the peak RSS of the process */
+  static void printSummary();
+
+  /** \brief Name of a subsystem for display */
+  static const char* getSubsystemName(MemorySubsystem subsystem);
+};
+
+/**
+ * \brief Standard allocator that counts its memory against a subsystem, e.g.
+ *        std::vector<double, CountingAllocator<double, MEMORY_IK_BUFFERS>>
+ */
+template <class T, MemorySubsystem Subsystem>
+struct CountingAllocator
+{
+  typedef T value_type;
+
+  template <class U>
+  struct rebind
+  {
+    typedef CountingAllocator<U, Subsystem> other;
+  };
+
+  CountingAllocator() noexcept
+  {
+  }
+
+  template <class U>
+  CountingAllocator(const CountingAllocator<U, Subsystem>&) noexcept
+  {
+  }
+
+  T* allocate(std::size_t n)
+  {
+    T* memory = static_cast<T*>(::operator new(n * sizeof(T)));
+    MemoryTracker::recordAllocation(Subsystem, n * sizeof(T));
+    return memory;
+  }
+
+  void deallocate(T* memory, std::size_t n) noexcept
+  {
+    MemoryTracker::recordDeallocation(Subsystem, n * sizeof(T));
+    ::operator delete(memory);
+  }
+};
+
+template <class T, class U, MemorySubsystem Subsystem>
+bool operator==(const CountingAllocator<T, Subsystem>&, const CountingAllocator<U, Subsystem>&)
+{
+  return true;
+}
+
+template <class T, class U, MemorySubsystem Subsystem>
+bool operator!=(const CountingAllocator<T, Subsystem>&, const CountingAllocator<U, Subsystem>&)
+{
+  return false;
+}
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_MEMORY_USAGE_H
@@ -0,0 +1,162 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Process wide counters, gauges and histograms updated lock free from the hot paths
+*/
+
+#ifndef CURIE_DEMOS_METRICS_H
+#define CURIE_DEMOS_METRICS_H
+
+// C++
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace curie_demos
+{
+/** \brief Monotonic count. Threads increment different cache lines, which are only summed when read */
+class MetricCounter
+{
+public:
+  void increment(std::uint64_t count = 1)
+  {
+    shards_[getShardIndex()].value_.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  std::uint64_t getValue() const;
+
+private:
+  static const std::size_t NUM_SHARDS = 16;
+
+  /** \brief Threads take the shards in turn as they first increment a counter */
+  static std::size_t getShardIndex();
+
+  // Padded rather than aligned, heap allocations are not over-aligned before C++17
+  struct Shard
+  {
+    std::atomic<std::uint64_t> value_{ 0 };
+    char padding_[64 - sizeof(std::atomic<std::uint64_t>)];
+  };
+  Shard shards_[NUM_SHARDS];
+};
+
+/** \brief Value that is set rather than accumulated, e.g. memory in use */
+class MetricGauge
+{
+public:
+  void set(double value)
+  {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  double getValue() const
+  {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<double> value_{ 0.0 };
+};
+
+/** \brief Distribution of observations, e.g. durations, over fixed buckets */
+class MetricHistogram
+{
+public:
+  /** \brief Upper bounds of the buckets in increasing order, a final bucket holds everything larger */
+  explicit MetricHistogram(const std::vector<double>& bounds);
+
+  void observe(double value);
+
+  const std::vector<double>& getBounds() const
+  {
+    return bounds_;
+  }
+
+  /** \brief Number of observations in each bucket, not cumulative, the last being above every bound */
+  std::vector<std::uint64_t> getBucketCounts() const;
+
+  double getSum() const
+  {
+    return sum_.load(std::memory_order_relaxed);
+  }
+
+private:
+  const std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> counts_;
+  std::atomic<double> sum_{ 0.0 };
+};
+
+/**
+ * \brief Registry of named metrics. Look a metric up once, e.g. in a function local static, and update it through
+ *        the reference, which stays valid for the life of the process. Registering the same name again returns
+ *        the existing metric
+ */
+class Metrics
+{
+public:
+  static MetricCounter& getCounter(const std::string& name, const std::string& help);
+
+  static MetricGauge& getGauge(const std::string& name, const std::string& help);
+
+  static MetricHistogram& getHistogram(const std::string& name, const std::string& help,
+                                       const std::vector<double>& bounds);
+
+  /** \brief Bucket bounds from 1ms to 100s for timing */
+  static const std::vector<double>& getSecondsBounds();
+
+  /** \brief States checked for collision, shared by every state check against the collision scene - the OMPL
+   *         validity checker, the batch sampler behind the state reservoir and the conservative motion validator */
+  static MetricCounter& getValidityChecksCounter();
+
+  /** \brief Of the states counted by getValidityChecksCounter(), those found in collision */
+  static MetricCounter& getValidityCollisionsCounter();
+
+  /** \brief Current value of every metric as name/value pairs, histograms as their count, sum and mean */
+  static void getValues(std::vector<std::pair<std::string, double>>& values);
+
+  /** \brief Write every metric in the Prometheus text exposition format */
+  static void writePrometheus(std::ostream& out);
+
+  /** \brief Write the Prometheus text to a file, replacing it atomically so readers never see a partial file */
+  static bool savePrometheus(const std::string& file_path);
+};
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_METRICS_H
@@ -0,0 +1,95 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Periodically publish the metrics registry as diagnostics and write it for Prometheus
+*/
+
+#ifndef CURIE_DEMOS_METRICS_PUBLISHER_H
+#define CURIE_DEMOS_METRICS_PUBLISHER_H
+
+// C++
+#include <map>
+#include <mutex>
+#include <string>
+
+// ROS
+#include <ros/ros.h>
+
+namespace curie_demos
+{
+/**
+ * \brief On a wall timer, refreshes the memory gauges, publishes every metric as a diagnostic_msgs/DiagnosticArray
+ *        with the per second rate of each counter, and rewrites a Prometheus text file e.g. for the node exporter
+ *        textfile collector. Timer callbacks need a spinner running
+ */
+class MetricsPublisher
+{
+public:
+  /**
+   * \brief Constructor
+   * \param nh - the topic "metrics" is advertised in its namespace
+   * \param period - seconds between updates
+   * \param file_path - where to write the Prometheus text, empty to only publish
+   */
+  MetricsPublisher(ros::NodeHandle nh, double period, const std::string& file_path);
+
+  /** \brief Update the gauges, publish and write the file now */
+  void update();
+
+private:
+  void timerCallback(const ros::WallTimerEvent& event);
+
+  // The short name of this class
+  std::string name_ = "metrics_publisher";
+
+  ros::Publisher publisher_;
+  ros::WallTimer timer_;
+  std::string file_path_;
+
+  // Updates come from the timer and from callers of update()
+  std::mutex mutex_;
+
+  // Counter values of the previous update, for rates
+  std::map<std::string, double> previous_values_;
+  ros::WallTime previous_time_;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<MetricsPublisher> MetricsPublisherPtr;
+typedef boost::shared_ptr<const MetricsPublisher> MetricsPublisherConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_METRICS_PUBLISHER_H
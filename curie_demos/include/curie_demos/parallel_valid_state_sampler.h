@@ -0,0 +1,83 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Valid state sampler that draws and collision checks candidate states on multiple threads
+*/
+
+#ifndef CURIE_DEMOS_PARALLEL_VALID_STATE_SAMPLER_H
+#define CURIE_DEMOS_PARALLEL_VALID_STATE_SAMPLER_H
+
+// OMPL
+#include <ompl/base/ValidStateSampler.h>
+#include <ompl/base/SpaceInformation.h>
+
+// this package
+#include <curie_demos/state_reservoir.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Drop-in replacement for OMPL's UniformValidStateSampler. Random sampling and validity checking
+ *        (the expensive part of roadmap generation) are done ahead of time by the producer threads of a
+ *        StateReservoir, so sample() usually just copies a pre-validated state out of a lock-free buffer.
+ *        Whatever consumes the samples (e.g. the SPARS criteria) still runs serially on its own thread.
+ */
+class ParallelValidStateSampler : public ompl::base::ValidStateSampler
+{
+public:
+  /**
+   * \brief Constructor
+   * \param si - the space to sample
+   * \param reservoir - source of pre-validated states, must check validity the same way as si
+   */
+  ParallelValidStateSampler(const ompl::base::SpaceInformation *si, StateReservoirPtr reservoir);
+
+  /** \brief Sample a valid state from the reservoir */
+  virtual bool sample(ompl::base::State *state);
+
+  /** \brief Sample a valid state near another. Not pre-computed because the seed changes each call */
+  virtual bool sampleNear(ompl::base::State *state, const ompl::base::State *near, const double distance);
+
+private:
+  // Shared source of valid states
+  StateReservoirPtr reservoir_;
+
+  // Serial sampler for sampleNear()
+  ompl::base::StateSamplerPtr near_sampler_;
+};  // end class
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_PARALLEL_VALID_STATE_SAMPLER_H
@@ -0,0 +1,105 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Walks a geometric path one waypoint at a time through a single reusable robot state
+*/
+
+#ifndef CURIE_DEMOS_PATH_STREAMER_H
+#define CURIE_DEMOS_PATH_STREAMER_H
+
+// C++
+#include <functional>
+#include <limits>
+
+// MoveIt
+#include <moveit/robot_state/robot_state.h>
+
+// OMPL
+#include <ompl/geometric/PathGeometric.h>
+#include <moveit_ompl/model_based_state_space.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Alternative to converting a whole og::PathGeometric into a robot_trajectory::RobotTrajectory, which
+ *        allocates a RobotState per waypoint. Waypoints are the path's states plus, if max_step is set,
+ *        states interpolated so that no two consecutive waypoints are further apart than max_step. Each
+ *        waypoint is written into the caller's RobotState and handed to a callback, so memory use does not
+ *        depend on the length of the path. Waypoints are numbered, so ranges can be streamed by separate threads
+ */
+class PathStreamer
+{
+public:
+  /** \brief Called for each waypoint, return false to stop streaming */
+  typedef std::function<bool(std::size_t index, const moveit::core::RobotState &robot_state)> WayPointCallback;
+
+  /** \brief Constructor. A max_step of 0 streams only the path's states */
+  PathStreamer(moveit_ompl::ModelBasedStateSpacePtr space, double max_step = 0.0);
+
+  /** \brief Number of waypoints that stream() will produce for a path */
+  std::size_t getWayPointCount(const ompl::geometric::PathGeometric &path) const;
+
+  /**
+   * \brief Produce waypoints [begin, end) of a path
+   * \param robot_state - buffer each waypoint is written into, must be for the space's robot model
+   * \return false if the callback stopped streaming
+   */
+  bool stream(const ompl::geometric::PathGeometric &path, moveit::core::RobotState &robot_state,
+              const WayPointCallback &callback, std::size_t begin = 0,
+              std::size_t end = std::numeric_limits<std::size_t>::max()) const;
+
+  /** \brief Get a single waypoint, e.g. to explain why it is invalid */
+  bool getWayPoint(const ompl::geometric::PathGeometric &path, std::size_t index,
+                   moveit::core::RobotState &robot_state) const;
+
+private:
+  /** \brief Number of waypoints added by the segment from s1 to s2, including s2 */
+  std::size_t getSegmentCount(const ompl::base::State *s1, const ompl::base::State *s2) const;
+
+  // The short name of this class
+  std::string name_ = "path_streamer";
+
+  moveit_ompl::ModelBasedStateSpacePtr space_;
+
+  double max_step_;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<PathStreamer> PathStreamerPtr;
+typedef boost::shared_ptr<const PathStreamer> PathStreamerConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_PATH_STREAMER_H
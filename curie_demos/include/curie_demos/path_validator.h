@@ -0,0 +1,144 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Checks the waypoints of a solution path in parallel, optionally while planning continues
+*/
+
+#ifndef CURIE_DEMOS_PATH_VALIDATOR_H
+#define CURIE_DEMOS_PATH_VALIDATOR_H
+
+// C++
+#include <functional>
+#include <future>
+#include <vector>
+
+// MoveIt
+#include <moveit/planning_scene/planning_scene.h>
+
+// this package
+#include <curie_demos/path_streamer.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Replacement for PlanningScene::isPathValid() that splits the waypoints into contiguous chunks, one per
+ *        thread. Each thread validates its waypoints in its own copy of the robot state, so the trajectory is
+ *        only read. Geometric paths are streamed by each thread straight into that state, without building a
+ *        RobotTrajectory. Contacts are not computed here - use getContacts() on the few indices that fail.
+ *        The planning scene must not change while a check is running, for a scene that is written to, e.g. by the
+ *        planning scene monitor, pass each check an immutable snapshot with setPlanningScene()
+ */
+class PathValidator
+{
+public:
+  /** \brief Constructor. A num_threads of 0 uses all cores */
+  PathValidator(planning_scene::PlanningSceneConstPtr planning_scene, PathStreamerPtr path_streamer,
+                std::size_t num_threads = 0);
+
+  /** \brief Destructor - waits for any check in progress */
+  ~PathValidator();
+
+  /**
+   * \brief Check every waypoint produced by the path streamer for collision and feasibility, blocking until done
+   * \param invalid_index - sorted indices of invalid waypoints
+   * \return true if all waypoints are valid
+   */
+  bool checkPath(const ompl::geometric::PathGeometric &path, std::vector<std::size_t> &invalid_index) const;
+
+  /** \brief Replace the scene checked against, waiting for any check in progress first */
+  void setPlanningScene(planning_scene::PlanningSceneConstPtr planning_scene);
+
+  /** \brief Start checking a copy of the path on worker threads and return immediately. Any previous check is
+   *         finished first and its result discarded */
+  void checkPathAsync(const ompl::geometric::PathGeometric &path);
+
+  /** \brief True if checkPathAsync() was called and its result not yet collected */
+  bool hasPendingResult() const
+  {
+    return pending_.valid();
+  }
+
+  /**
+   * \brief Block until the check started by checkPathAsync() finishes
+   * \param path - the path that was checked
+   * \param invalid_index - sorted indices of invalid waypoints
+   * \return true if all waypoints are valid
+   */
+  bool waitForResult(boost::shared_ptr<ompl::geometric::PathGeometric> &path, std::vector<std::size_t> &invalid_index);
+
+  /** \brief Compute the contacts of one (invalid) state, for explaining a failure */
+  void getContacts(const moveit::core::RobotState &state, collision_detection::CollisionResult &res) const;
+
+  std::size_t getNumThreads() const
+  {
+    return num_threads_;
+  }
+
+  const PathStreamerPtr &getPathStreamer() const
+  {
+    return path_streamer_;
+  }
+
+private:
+  /** \brief Check streamed waypoints [begin, end) using a private robot state */
+  void checkPathRange(const ompl::geometric::PathGeometric &path, std::size_t begin, std::size_t end,
+                      std::vector<std::size_t> &invalid_index) const;
+
+  /** \brief Run check_range on num_waypoints split into contiguous chunks across the threads */
+  bool checkInChunks(std::size_t num_waypoints,
+                     const std::function<void(std::size_t, std::size_t, std::vector<std::size_t> &)> &check_range,
+                     std::vector<std::size_t> &invalid_index) const;
+
+  // The short name of this class
+  std::string name_ = "path_validator";
+
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+
+  PathStreamerPtr path_streamer_;
+
+  std::size_t num_threads_;
+
+  // Check started by checkPathAsync()
+  std::future<std::vector<std::size_t>> pending_;
+  boost::shared_ptr<ompl::geometric::PathGeometric> pending_path_;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<PathValidator> PathValidatorPtr;
+typedef boost::shared_ptr<const PathValidator> PathValidatorConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_PATH_VALIDATOR_H
@@ -0,0 +1,69 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Derive independent, reproducible random number streams from a single master seed
+*/
+
+#ifndef CURIE_DEMOS_RANDOM_STREAMS_H
+#define CURIE_DEMOS_RANDOM_STREAMS_H
+
+// C++
+#include <cstddef>
+
+// Boost
+#include <boost/cstdint.hpp>
+
+namespace curie_demos
+{
+/**
+ * \brief Compute the seed of a sub-stream so that every worker/sampler gets its own generator, yet the
+ *        whole program is reproducible from one master seed. Uses the splitmix64 finalizer so that
+ *        neighbouring stream ids give uncorrelated seeds
+ * \param master_seed - seed of the whole run
+ * \param stream_id - index of the stream, e.g. the worker number
+ * \return seed for a random_numbers::RandomNumberGenerator or similar
+ */
+inline boost::uint32_t deriveStreamSeed(boost::uint32_t master_seed, std::size_t stream_id)
+{
+  boost::uint64_t z = (static_cast<boost::uint64_t>(master_seed) << 32) + stream_id + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z = z ^ (z >> 31);
+  return static_cast<boost::uint32_t>(z ^ (z >> 32));
+}
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_RANDOM_STREAMS_H
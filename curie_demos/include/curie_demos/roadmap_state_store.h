@@ -0,0 +1,196 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Joint values of every roadmap vertex in contiguous slabs, optionally quantized
+*/
+
+#ifndef CURIE_DEMOS_ROADMAP_STATE_STORE_H
+#define CURIE_DEMOS_ROADMAP_STATE_STORE_H
+
+// C++
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Boost
+#include <boost/shared_ptr.hpp>
+
+namespace curie_demos
+{
+/** \brief How a RoadmapStateStore keeps each joint value */
+enum StateStorageType
+{
+  STORAGE_DOUBLE,  // exact, 8 bytes per joint
+  STORAGE_FLOAT,   // 4 bytes per joint, relative error of 2^-24 of the largest magnitude stored
+  STORAGE_FIXED16  // 2 bytes per joint, the joint's bounds split into 65535 steps. Requires finite bounds
+};
+
+/**
+ * \brief Keeps the joint values of many states in large slabs instead of one heap allocation per state, so a
+ *        roadmap of millions of vertices pays no allocator headers or pointer per state. A state is referred to
+ *        by the index returned from addState(), and decoded on demand.
+ *
+ *        Quantized storage moves each joint by at most getQuantizationError(joint), so a stored distance is off
+ *        from the true distance by at most getDistanceErrorBound() for two stored states (half that when one side
+ *        is an exact query). Both depend on the values added so far - the float error grows with the largest magnitude
+ *        of each joint, and fixed point values outside the bounds are clamped, which widens the error of that joint
+ *        to the largest distance clamped. Code that must not be fooled by quantization, e.g. deciding if two
+ *        vertices are within a sparse delta, should use getDistanceBounds() and only trust the side of the
+ *        interval it needs
+ */
+class RoadmapStateStore
+{
+public:
+  /**
+   * \brief Constructor
+   * \param lower_bounds - of each joint, only used by STORAGE_FIXED16
+   * \param upper_bounds - of each joint, only used by STORAGE_FIXED16
+   * \param type - how to store each joint value
+   * \param slab_states - number of states in each slab
+   */
+  RoadmapStateStore(const std::vector<double>& lower_bounds, const std::vector<double>& upper_bounds,
+                    StateStorageType type, std::size_t slab_states = 65536);
+
+  /** \brief Destructor */
+  ~RoadmapStateStore();
+
+  /** \brief Copy a state into the store, values outside the bounds are clamped by STORAGE_FIXED16 and widen the
+   *         error bound */
+  std::size_t addState(const double* values);
+
+  /** \brief Decode a state into values, which has room for getDimensions() joints */
+  void getState(std::size_t index, double* values) const;
+
+  /** \brief Decode one joint of a state */
+  double getValue(std::size_t index, std::size_t joint) const;
+
+  /** \brief Euclidean distance between two stored states */
+  double distance(std::size_t index1, std::size_t index2) const;
+
+  /** \brief Euclidean distance between a stored state and exact values */
+  double distance(std::size_t index, const double* values) const;
+
+  /** \brief Interval that must contain the distance between the original values of two stored states */
+  void getDistanceBounds(std::size_t index1, std::size_t index2, double& lower, double& upper) const;
+
+  /** \brief Largest change of one joint value caused by storage, over the states added since the last clear() */
+  double getQuantizationError(std::size_t joint) const;
+
+  /** \brief Largest difference between the distance of two stored states and of their original values, over the
+   *         states added since the last clear() */
+  double getDistanceErrorBound() const
+  {
+    return distance_error_bound_;
+  }
+
+  /** \brief Number of joint values clamped to the bounds by STORAGE_FIXED16 since the last clear() */
+  std::size_t getNumClamped() const
+  {
+    return num_clamped_;
+  }
+
+  /** \brief Remove all states, keeping the slabs for reuse */
+  void clear();
+
+  /** \brief Number of states */
+  std::size_t size() const
+  {
+    return num_states_;
+  }
+
+  std::size_t getDimensions() const
+  {
+    return dim_;
+  }
+
+  StateStorageType getStorageType() const
+  {
+    return type_;
+  }
+
+  /** \brief Bytes used by one stored state */
+  std::size_t getBytesPerState() const
+  {
+    return state_bytes_;
+  }
+
+  /** \brief Memory held by the slabs, in bytes */
+  std::size_t getCapacityBytes() const;
+
+private:
+  /** \brief Start of a stored state */
+  const unsigned char* getStateData(std::size_t index) const
+  {
+    return slabs_[index / slab_states_].get() + (index % slab_states_) * state_bytes_;
+  }
+
+  void encode(const double* values, unsigned char* data) const;
+
+  /** \brief Widen the per joint errors to cover a newly added state */
+  void trackErrors(const double* values);
+
+  /** \brief Recompute distance_error_bound_ from the per joint errors */
+  void updateDistanceErrorBound();
+
+  std::size_t dim_;
+  StateStorageType type_;
+  std::size_t slab_states_;
+  std::size_t state_bytes_;
+
+  // Joint value = lower_bounds_ + fixed_value * scale_
+  std::vector<double> lower_bounds_;
+  std::vector<double> upper_bounds_;
+  std::vector<double> scale_;
+
+  // Largest magnitude of each joint stored, sets the float rounding error
+  std::vector<double> max_abs_values_;
+
+  // Largest distance each joint was moved to fit in the bounds of STORAGE_FIXED16
+  std::vector<double> max_clamp_errors_;
+  std::size_t num_clamped_ = 0;
+
+  double distance_error_bound_ = 0.0;
+
+  std::vector<std::unique_ptr<unsigned char[]>> slabs_;
+  std::size_t num_states_ = 0;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<RoadmapStateStore> RoadmapStateStorePtr;
+typedef boost::shared_ptr<const RoadmapStateStore> RoadmapStateStoreConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_ROADMAP_STATE_STORE_H
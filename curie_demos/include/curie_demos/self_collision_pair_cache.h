@@ -0,0 +1,131 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Self collision pairs of a planning group that are always or never in collision, found by sampling
+*/
+
+#ifndef CURIE_DEMOS_SELF_COLLISION_PAIR_CACHE_H
+#define CURIE_DEMOS_SELF_COLLISION_PAIR_CACHE_H
+
+// C++
+#include <string>
+#include <utility>
+#include <vector>
+
+// Boost
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+// MoveIt
+#include <moveit/collision_detection/collision_matrix.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/robot_state.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Samples random states of a planning group and records the self collision pairs that collided in every
+ *        sample, e.g. neighboring links designed to touch, and in none, e.g. links too far apart to ever meet.
+ *        Like the default collisions of the MoveIt setup assistant, "never" is only as good as the number of
+ *        samples. The result is saved next to the Bolt database so the sampling is done once per group, and is only
+ *        reused for the same sample count, seed, allowed collisions and values of the joints outside the group
+ */
+class SelfCollisionPairCache
+{
+public:
+  /** \brief Constructor */
+  SelfCollisionPairCache(const std::string& group_name);
+
+  /**
+   * \brief Classify the self collision pairs that can change as the group moves and are not yet allowed
+   * \param scene - robot and allowed collision matrix to sample with
+   * \param reference_state - values of the joints outside the group
+   * \param num_samples - random states of the group to check
+   * \param seed - of the random states, for reproducible results
+   */
+  bool compute(const planning_scene::PlanningScene& scene, const moveit::core::RobotState& reference_state,
+               std::size_t num_samples, boost::uint32_t seed);
+
+  /** \brief Write the pairs to file, along with the settings they were sampled with */
+  bool save(const std::string& file_path) const;
+
+  /**
+   * \brief Read pairs written by save(). The arguments are those compute() would be called with, and must match
+   *        the ones the pairs were sampled with - e.g. a changed SRDF or a moved joint outside the group can turn a
+   *        never pair into one that collides
+   * \return false if the file is missing, for another robot or group, or sampled with other settings
+   */
+  bool load(const std::string& file_path, const planning_scene::PlanningScene& scene,
+            const moveit::core::RobotState& reference_state, std::size_t num_samples, boost::uint32_t seed);
+
+  /** \brief Allow every always and never pair in acm, return number of pairs allowed */
+  std::size_t apply(collision_detection::AllowedCollisionMatrix& acm) const;
+
+  std::size_t getNumAlwaysPairs() const
+  {
+    return always_pairs_.size();
+  }
+
+  std::size_t getNumNeverPairs() const
+  {
+    return never_pairs_.size();
+  }
+
+private:
+  typedef std::pair<std::string, std::string> LinkPair;
+
+  // The short name of this class
+  std::string name_ = "self_collision_pair_cache";
+
+  std::string group_name_;
+  std::string robot_name_;
+  std::size_t num_samples_ = 0;
+  boost::uint32_t seed_ = 0;
+
+  // Identify the allowed collisions and the values of the joints outside the group the pairs were sampled with
+  boost::uint64_t acm_hash_ = 0;
+  boost::uint64_t reference_hash_ = 0;
+
+  std::vector<LinkPair> always_pairs_;
+  std::vector<LinkPair> never_pairs_;
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<SelfCollisionPairCache> SelfCollisionPairCachePtr;
+typedef boost::shared_ptr<const SelfCollisionPairCache> SelfCollisionPairCacheConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_SELF_COLLISION_PAIR_CACHE_H
@@ -0,0 +1,229 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Background service that keeps a lock-free buffer of valid robot states topped up
+*/
+
+#ifndef CURIE_DEMOS_STATE_RESERVOIR_H
+#define CURIE_DEMOS_STATE_RESERVOIR_H
+
+// C++
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// this package
+#include <curie_demos/batch_state_sampler.h>
+
+namespace curie_demos
+{
+/**
+ * \brief Fixed capacity single-producer / single-consumer queue of joint vectors. Lock-free: the producer
+ *        only writes head_ and the consumer only writes tail_
+ */
+class StateRingBuffer
+{
+public:
+  StateRingBuffer(std::size_t capacity, std::size_t dim) : capacity_(capacity), dim_(dim), data_(capacity * dim)
+  {
+  }
+
+  /** \brief Producer side. Returns false if the buffer is full */
+  bool push(const double *values)
+  {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == capacity_)
+      return false;
+    std::copy(values, values + dim_, &data_[(head % capacity_) * dim_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** \brief Consumer side. Returns false if the buffer is empty */
+  bool pop(double *values)
+  {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == tail)
+      return false;
+    const double *slot = &data_[(tail % capacity_) * dim_];
+    std::copy(slot, slot + dim_, values);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool full() const
+  {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire) == capacity_;
+  }
+
+  std::size_t size() const
+  {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  const std::size_t capacity_;
+  const std::size_t dim_;
+  std::vector<double, CountingAllocator<double, MEMORY_SPARSE_SAMPLING>> data_;
+
+  // Padded onto separate cache lines so producer and consumer do not contend. Padded rather than aligned, heap
+  // allocations are not over-aligned before C++17
+  char padding0_[64];
+  std::atomic<std::size_t> head_{ 0 };
+  char padding1_[64 - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> tail_{ 0 };
+  char padding2_[64 - sizeof(std::atomic<std::size_t>)];
+};
+typedef boost::shared_ptr<StateRingBuffer> StateRingBufferPtr;
+
+/**
+ * \brief Producer threads keep a set of ring buffers filled with pre-validated states so that consumers
+ *        (start/goal generation, the sparse roadmap generator) rarely wait on rejection sampling.
+ *        States come from a fixed number of random streams seeded from the master seed, and take()
+ *        reads the streams round robin, so the sequence of states is reproducible and independent of
+ *        the number of producer threads. take() is thread safe, concurrent consumers share that one sequence.
+ *        A stream whose sampler fails is retried with backoff, as rejection heavy scenes often fail a few
+ *        batches in a row, and only given up after setMaxFailedAttempts() failures in a row.
+ *        A consumer waiting on an empty stream, and a producer whose streams are all full, sleep on a condition
+ *        variable instead of spinning, so waiting never takes a core from the producers
+ */
+class StateReservoir
+{
+public:
+  /**
+   * \brief Constructor - starts the producer threads
+   * \param space - the state space whose joint model group is sampled
+   * \param planning_scene - the environment to check against
+   * \param robot_state - template for the joints that are not part of the group
+   * \param master_seed - all random streams are derived from this
+   * \param group_name - links to collision check, empty to check the whole robot
+   * \param checking_enabled - debugging mode that accepts every sample when false
+   * \param num_threads - number of producers, 0 means one per hardware core
+   * \param num_streams - number of independent random streams, must not change to reproduce a run
+   * \param stream_capacity - number of states buffered per stream
+   */
+  StateReservoir(moveit_ompl::ModelBasedStateSpacePtr space, planning_scene::PlanningSceneConstPtr planning_scene,
+                 const moveit::core::RobotState &robot_state, boost::uint32_t master_seed,
+                 const std::string &group_name, bool checking_enabled = true, std::size_t num_threads = 0,
+                 std::size_t num_streams = 32, std::size_t stream_capacity = 32);
+
+  /** \brief Destructor - stops the producer threads */
+  ~StateReservoir();
+
+  /** \brief Stop and join the producer threads. States already buffered can still be taken */
+  void stop();
+
+  /** \brief Number of failed sampler calls in a row after which a stream is given up, 0 retries forever */
+  void setMaxFailedAttempts(std::size_t max_failed_attempts)
+  {
+    max_failed_attempts_ = max_failed_attempts;
+  }
+
+  /**
+   * \brief Get the next valid state, waiting for the producers if needed
+   * \return false if the producers could not find any more valid states
+   */
+  bool take(double *values);
+  bool take(moveit::core::RobotState &robot_state);
+  bool take(ompl::base::State *state);
+
+  /** \brief Number of states currently buffered across all streams */
+  std::size_t size() const;
+
+  /** \brief Getter for number of producer threads */
+  std::size_t getNumThreads() const
+  {
+    return threads_.size();
+  }
+
+private:
+  /** \brief Producer body: keep every stream assigned to this thread full */
+  void produce(std::size_t thread_id, std::size_t num_threads);
+
+  /** \brief Producer loop, may throw */
+  void produceStreams(std::size_t thread_id, std::size_t num_threads);
+
+  /** \brief Next state of the sequence, the caller holds take_mutex_ */
+  bool takeLocked(double *values);
+
+  /** \brief Stop filling a stream and wake a consumer waiting on it */
+  void setExhausted(std::size_t stream_id);
+
+  /** \brief Wake the threads waiting on a condition variable. Taking wake_mutex_ first means a waiter cannot miss
+   *         a change made just before it went to sleep */
+  void notify(std::condition_variable &condition);
+
+  // The short name of this class
+  std::string name_ = "state_reservoir";
+
+  // Conversion between MoveIt and OMPL, used on the consumer side only
+  moveit_ompl::ModelBasedStateSpacePtr space_;
+  const moveit::core::JointModelGroup *jmg_;
+  moveit::core::RobotState robot_state_;
+  std::vector<double> values_;
+
+  // One sampler and one buffer per stream
+  std::vector<BatchStateSamplerPtr> samplers_;
+  std::vector<StateRingBufferPtr> buffers_;
+
+  // Set by a stream's producer when its sampler gives up, or its thread fails
+  std::vector<boost::shared_ptr<std::atomic<bool> > > exhausted_;
+  std::atomic<std::size_t> max_failed_attempts_{ 0 };
+
+  // Serializes consumers, protects next_stream_ and the conversion scratch
+  std::mutex take_mutex_;
+
+  // Next stream to read from
+  std::size_t next_stream_ = 0;
+
+  // Consumers wait for a state to be produced, idle producers for one to be taken
+  std::mutex wake_mutex_;
+  std::condition_variable produced_;
+  std::condition_variable consumed_;
+
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_{ false };
+};  // end class
+
+// Create boost pointers for this class
+typedef boost::shared_ptr<StateReservoir> StateReservoirPtr;
+typedef boost::shared_ptr<const StateReservoir> StateReservoirConstPtr;
+
+}  // namespace curie_demos
+
+#endif  // CURIE_DEMOS_STATE_RESERVOIR_H
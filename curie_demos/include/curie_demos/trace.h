@@ -0,0 +1,112 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Scoped trace events of the major phases, buffered per thread and exported for chrome://tracing
+*/
+
+#ifndef CURIE_DEMOS_TRACE_H
+#define CURIE_DEMOS_TRACE_H
+
+// C++
+#include <cstdint>
+#include <string>
+
+namespace curie_demos
+{
+/**
+ * \brief Process wide recorder of timed events. Each thread appends to its own buffer, so recording never waits
+ *        on another thread, and save() writes every buffer in the Chrome trace event format, which can be opened
+ *        in chrome://tracing or ui.perfetto.dev. Off by default, when disabled a scope costs one atomic load.
+ *        The buffer of a finished thread is handed to the next new thread, so short lived workers, e.g. the
+ *        threads of each path check, share a row of the trace instead of adding a buffer each
+ */
+class Tracer
+{
+public:
+  /** \brief Record events, off by default */
+  static void setEnabled(bool enabled);
+
+  static bool isEnabled();
+
+  /** \brief Nanoseconds on a monotonic clock */
+  static std::uint64_t now();
+
+  /** \brief Start an event, returning its begin time. Takes the calling thread's buffer first, so a thread that
+   *         is handed the buffer later cannot record an event overlapping this one in the same row */
+  static std::uint64_t beginEvent();
+
+  /** \brief Add a complete event to the calling thread's buffer. The name must outlive the tracer, e.g. a string
+   *         literal, and begin_ns come from beginEvent() */
+  static void record(const char* name, std::uint64_t begin_ns, std::uint64_t end_ns);
+
+  /** \brief Write every recorded event as a Chrome trace JSON file */
+  static bool save(const std::string& file_path);
+
+  /** \brief Discard every recorded event */
+  static void clear();
+};
+
+/** \brief Records an event covering its own lifetime, use TRACE_SCOPE() */
+class TraceScope
+{
+public:
+  explicit TraceScope(const char* name)
+    : name_(Tracer::isEnabled() ? name : nullptr), begin_ns_(name_ ? Tracer::beginEvent() : 0)
+  {
+  }
+
+  ~TraceScope()
+  {
+    if (name_)
+      Tracer::record(name_, begin_ns_, Tracer::now());
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+  const char* name_;
+  std::uint64_t begin_ns_;
+};
+
+}  // namespace curie_demos
+
+#define CURIE_DEMOS_TRACE_CONCAT_IMPL(a, b) a##b
+#define CURIE_DEMOS_TRACE_CONCAT(a, b) CURIE_DEMOS_TRACE_CONCAT_IMPL(a, b)
+
+/** \brief Trace the rest of the enclosing block under a string literal name */
+#define TRACE_SCOPE(name) ::curie_demos::TraceScope CURIE_DEMOS_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif  // CURIE_DEMOS_TRACE_H
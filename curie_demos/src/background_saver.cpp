@@ -0,0 +1,128 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Writes the experience database to disk on a worker thread so planning is not blocked
+*/
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/background_saver.h>
+#include <curie_demos/metrics.h>
+#include <curie_demos/trace.h>
+
+namespace curie_demos
+{
+BackgroundSaver::BackgroundSaver(ompl::tools::ExperienceSetupPtr experience_setup)
+  : experience_setup_(experience_setup)
+{
+  thread_ = std::thread(&BackgroundSaver::saveThread, this);
+}
+
+BackgroundSaver::~BackgroundSaver()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  condition_.notify_all();
+
+  // The worker drains any outstanding request before exiting
+  thread_.join();
+}
+
+void BackgroundSaver::requestSave()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    save_requested_ = true;
+  }
+  condition_.notify_all();
+}
+
+void BackgroundSaver::waitUntilIdle()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (save_requested_ || saving_)
+    ROS_INFO_STREAM_NAMED(name_, "Waiting for background save of experience database to finish");
+
+  condition_.wait(lock, [this]
+                  {
+                    return !save_requested_ && !saving_;
+                  });
+}
+
+bool BackgroundSaver::isBusy()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  return save_requested_ || saving_;
+}
+
+void BackgroundSaver::saveThread()
+{
+  static MetricHistogram &save_seconds = Metrics::getHistogram(
+      "curie_demos_database_save_seconds", "Time to write the experience database", Metrics::getSecondsBounds());
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    condition_.wait(lock, [this]
+                    {
+                      return save_requested_ || shutdown_;
+                    });
+
+    if (!save_requested_)  // shutdown with nothing left to do
+      break;
+
+    save_requested_ = false;
+    saving_ = true;
+    lock.unlock();
+
+    TRACE_SCOPE("save_database");
+    ros::WallTime start_time = ros::WallTime::now();
+    experience_setup_->saveIfChanged();
+    const double duration = (ros::WallTime::now() - start_time).toSec();
+    save_seconds.observe(duration);
+    ROS_DEBUG_STREAM_NAMED(name_, "Background save finished in " << duration << " seconds");
+
+    lock.lock();
+    saving_ = false;
+    num_saves_++;
+    condition_.notify_all();
+  }
+}
+
+}  // namespace curie_demos
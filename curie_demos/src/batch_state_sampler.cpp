@@ -0,0 +1,226 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Generate valid robot states in batches, rejecting samples with the cheapest checks first
+*/
+
+// C++
+#include <algorithm>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/batch_state_sampler.h>
+#include <curie_demos/metrics.h>
+
+namespace curie_demos
+{
+BatchStateSampler::BatchStateSampler(moveit_ompl::ModelBasedStateSpacePtr space,
+                                     planning_scene::PlanningSceneConstPtr planning_scene,
+                                     const moveit::core::RobotState &robot_state, boost::uint32_t seed,
+                                     const std::string &group_name, std::size_t batch_size)
+  : space_(space)
+  , planning_scene_(planning_scene)
+  , jmg_(space->getJointModelGroup())
+  , robot_state_(robot_state)
+  , rng_(seed)
+  , dim_(jmg_->getVariableCount())
+  , batch_size_(std::max<std::size_t>(1, batch_size))
+{
+  collision_request_.group_name = group_name;
+
+  // Sample within the same bounds as the state space
+  const moveit::core::RobotModelConstPtr &robot_model = robot_state_.getRobotModel();
+  for (const std::string &variable : jmg_->getVariableNames())
+  {
+    const moveit::core::VariableBounds &bounds = robot_model->getVariableBounds(variable);
+    min_position_.push_back(bounds.min_position_);
+    max_position_.push_back(bounds.max_position_);
+  }
+
+  batch_.resize(dim_ * batch_size_);
+  survivors_.reserve(batch_size_);
+  sample_values_.resize(dim_);
+}
+
+bool BatchStateSampler::sample(moveit::core::RobotState &robot_state)
+{
+  if (!sample(&sample_values_[0]))
+    return false;
+
+  robot_state.setJointGroupPositions(jmg_, sample_values_);
+  robot_state.update();
+  return true;
+}
+
+bool BatchStateSampler::sample(ompl::base::State *state)
+{
+  if (!sample(robot_state_))
+    return false;
+
+  space_->copyToOMPLState(state, robot_state_);
+  return true;
+}
+
+bool BatchStateSampler::sample(double *values)
+{
+  if (!fill(1))
+    return false;
+
+  const double *back = &reservoir_[reservoir_.size() - dim_];
+  std::copy(back, back + dim_, values);
+  reservoir_.resize(reservoir_.size() - dim_);
+  return true;
+}
+
+bool BatchStateSampler::fill(std::size_t num_states)
+{
+  std::size_t empty_batches = 0;
+  while (getReservoirSize() < num_states)
+  {
+    if (sampleBatch() > 0)
+      empty_batches = 0;
+    else if (++empty_batches >= max_empty_batches_)
+    {
+      if (verbose_)
+        ROS_ERROR_STREAM_NAMED(name_, "Unable to find valid random robot state after "
+                                          << empty_batches * batch_size_ << " samples");
+      return false;
+    }
+
+    if (empty_batches == 1 && verbose_)
+      ROS_WARN_STREAM_NAMED(name_, "Taking long time to find valid random state");
+  }
+  return true;
+}
+
+double BatchStateSampler::getAcceptanceRate() const
+{
+  if (num_drawn_ == 0)
+    return 0.0;
+  std::size_t num_rejected = num_rejected_world_ + num_rejected_self_ + num_rejected_feasibility_;
+  return (num_drawn_ - num_rejected) / static_cast<double>(num_drawn_);
+}
+
+void BatchStateSampler::printStats() const
+{
+  ROS_INFO_STREAM_NAMED(name_, "Drew " << num_drawn_ << " samples, acceptance rate " << getAcceptanceRate() * 100.0
+                                       << "%. Rejected by world collision: " << num_rejected_world_
+                                       << ", self collision: " << num_rejected_self_
+                                       << ", feasibility: " << num_rejected_feasibility_);
+}
+
+std::size_t BatchStateSampler::sampleBatch()
+{
+  // Draw the whole batch one variable at a time
+  for (std::size_t d = 0; d < dim_; ++d)
+  {
+    double *column = &batch_[d * batch_size_];
+    for (std::size_t i = 0; i < batch_size_; ++i)
+      column[i] = rng_.uniformReal(min_position_[d], max_position_[d]);
+  }
+  num_drawn_ += batch_size_;
+
+  survivors_.clear();
+  for (std::size_t i = 0; i < batch_size_; ++i)
+    survivors_.push_back(i);
+
+  if (checking_enabled_)
+  {
+    const collision_detection::AllowedCollisionMatrix &acm = planning_scene_->getAllowedCollisionMatrix();
+
+    // Counted with the validity checker's states, once per batch
+    Metrics::getValidityChecksCounter().increment(survivors_.size());
+    std::size_t num_collisions = 0;
+
+    // Forward kinematics once per candidate, then every stage until one rejects it
+    std::size_t num_kept = 0;
+    for (std::size_t i : survivors_)
+    {
+      loadSample(i);
+
+      // Stage 1: feasibility
+      if (!planning_scene_->isStateFeasible(robot_state_))
+      {
+        num_rejected_feasibility_++;
+        continue;
+      }
+
+      // Stage 2: self collision
+      collision_detection::CollisionResult res;
+      planning_scene_->getCollisionRobotUnpadded()->checkSelfCollision(collision_request_, res, robot_state_, acm);
+      if (res.collision)
+      {
+        num_rejected_self_++;
+        num_collisions++;
+        continue;
+      }
+
+      // Stage 3: collision with the world
+      res.clear();
+      planning_scene_->getCollisionWorld()->checkRobotCollision(collision_request_, res,
+                                                                *planning_scene_->getCollisionRobot(), robot_state_,
+                                                                acm);
+      if (res.collision)
+      {
+        num_rejected_world_++;
+        num_collisions++;
+        continue;
+      }
+
+      survivors_[num_kept++] = i;
+    }
+    survivors_.resize(num_kept);
+    Metrics::getValidityCollisionsCounter().increment(num_collisions);
+  }
+
+  // Move the survivors into the reservoir
+  for (std::size_t i : survivors_)
+    for (std::size_t d = 0; d < dim_; ++d)
+      reservoir_.push_back(batch_[d * batch_size_ + i]);
+
+  return survivors_.size();
+}
+
+void BatchStateSampler::loadSample(std::size_t i)
+{
+  for (std::size_t d = 0; d < dim_; ++d)
+    sample_values_[d] = batch_[d * batch_size_ + i];
+  robot_state_.setJointGroupPositions(jmg_, sample_values_);
+  robot_state_.update();
+}
+
+}  // namespace curie_demos
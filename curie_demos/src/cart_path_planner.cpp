@@ -42,7 +42,9 @@
 // this package
 #include <curie_demos/cart_path_planner.h>
 #include <curie_demos/curie_demos.h>
+#include <curie_demos/metrics.h>
 #include <curie_demos/path_loader.h>
+#include <curie_demos/trace.h>
 
 // moveit_boilerplate
 #include <moveit_boilerplate/namespaces.h>
@@ -52,6 +54,8 @@ namespace curie_demos
 CartPathPlanner::CartPathPlanner(CurieDemos* parent) : name_("cart_path_planner"), nh_("~"), parent_(parent)
 {
   jmg_ = parent_->jmg_;
+  joint_pose_arena_.reset(new JointPoseArena(jmg_->getVariableCount()));
+  layered_solver_.reset(new LayeredPathSolver());
 
   // Load planning state
   imarker_state_.reset(new moveit::core::RobotState(*parent_->moveit_start_));
@@ -85,6 +89,13 @@ CartPathPlanner::CartPathPlanner(CurieDemos* parent) : name_("cart_path_planner"
   error += !rosparam_shortcuts::get(name_, rpnh, "timing", timing_);
   rosparam_shortcuts::shutdownIfError(name_, error);
 
+  // Joint velocity limits between Cartesian points
+  velocity_filter_.reset(new JointVelocityFilter(jmg_, timing_));
+
+  // Specify tolerance for exact_poses
+  // orientation_tol_ = OrientationTol(M_PI, 0, 0);
+  orientation_tol_ = OrientationTol(M_PI, M_PI / 5, M_PI / 5);
+
   // initializing descartes
   initDescartes();
 
@@ -143,23 +154,51 @@ void CartPathPlanner::processIMarkerPose(const visualization_msgs::InteractiveMa
 bool CartPathPlanner::generateExactPoses(bool debug)
 {
   // Generate exact poses
+  return generateExactPoses(getStartPose(), debug);
+}
+
+Eigen::Affine3d CartPathPlanner::getStartPose()
+{
   imarker_state_ = imarker_cartesian_->getRobotState();
-  Eigen::Affine3d start_pose = imarker_state_->getGlobalLinkTransform(parent_->ee_link_);
+  return imarker_state_->getGlobalLinkTransform(parent_->ee_link_);
+}
+
+void CartPathPlanner::setOrientationIncrement(double orientation_increment)
+{
+  orientation_increment_ = orientation_increment;
+
+  // The candidate poses change
+  layer_joint_poses_.clear();
+  joint_pose_arena_->reset();
+}
+
+void CartPathPlanner::setOrientationTol(const OrientationTol& orientation_tol)
+{
+  orientation_tol_ = orientation_tol;
 
-  generateExactPoses(start_pose, debug);
+  // The candidate poses change
+  layer_joint_poses_.clear();
+  joint_pose_arena_->reset();
 }
 
 bool CartPathPlanner::generateExactPoses(const Eigen::Affine3d& start_pose, bool debug)
 {
+  TRACE_SCOPE("generate_exact_poses");
   // ROS_DEBUG_STREAM_NAMED(name_, "generateExactPoses()");
   if (debug)
     ROS_WARN_STREAM_NAMED(name_, "Running generateExactPoses() in debug mode");
 
+  ros::WallTime start_time = ros::WallTime::now();
   if (!transform2DPath(start_pose, exact_poses_))
   {
     ROS_ERROR_STREAM_NAMED(name_, "Trajectory generation failed");
     exit(-1);
   }
+  stats_.transform_path_time_ += (ros::WallTime::now() - start_time).toSec();
+
+  // IK solutions belong to the previous poses
+  layer_joint_poses_.clear();
+  joint_pose_arena_->reset();
 
   ROS_DEBUG_STREAM_NAMED(name_ + ".generation", "Generated exact Cartesian traj with " << exact_poses_.size() << " poin"
                                                                                                                  "ts");
@@ -170,11 +209,6 @@ bool CartPathPlanner::generateExactPoses(const Eigen::Affine3d& start_pose, bool
   visual_tools_->publishAxisPath(exact_poses_, rvt::XXXSMALL);
   visual_tools_->triggerBatchPublish();
 
-  // Specify tolerance for new exact_poses
-  // orientation_tol_ = OrientationTol(M_PI, 0, 0);
-  orientation_tol_ = OrientationTol(M_PI, M_PI / 5, M_PI / 5);
-  // rosparam timing_ = 0.1;
-
   if (debug)
     debugShowAllIKSolutions();
 
@@ -344,6 +378,8 @@ bool CartPathPlanner::transform2DPath(const Eigen::Affine3d& starting_pose, Eige
 
 bool CartPathPlanner::populateBoltGraph(ompl::tools::bolt::TaskGraphPtr task_graph)
 {
+  TRACE_SCOPE("populate_task_graph");
+  const ros::WallTime populate_start_time = ros::WallTime::now();
   std::size_t indent = 0;
   task_graph_ = task_graph;  // copy into this class to share among all functions
 
@@ -377,18 +413,40 @@ bool CartPathPlanner::populateBoltGraph(ompl::tools::bolt::TaskGraphPtr task_gra
   // For converting to MoveIt! format
   moveit::core::RobotStatePtr moveit_robot_state(new moveit::core::RobotState(*visual_tools_->getSharedRobotState()));
 
+  // Reuse the IK solutions when the graph is regenerated for the same poses
+  const bool reuse_joint_poses = layer_joint_poses_.size() == exact_poses_.size();
+  static MetricCounter& ik_hits = Metrics::getCounter("curie_demos_cart_ik_cache_hits_total",
+                                                      "Cartesian graph generations reusing the IK solutions");
+  static MetricCounter& ik_misses = Metrics::getCounter("curie_demos_cart_ik_cache_misses_total",
+                                                        "Cartesian graph generations solving IK for every point");
+  (reuse_joint_poses ? ik_hits : ik_misses).increment();
+  if (!reuse_joint_poses)
+  {
+    layer_joint_poses_.resize(exact_poses_.size());
+    joint_pose_arena_->reset();
+  }
+
   // Enumerate the potential cartesian poses within tolerance
   std::size_t total_vertices = 0;
   for (std::size_t traj_id = 0; traj_id < exact_poses_.size(); ++traj_id)
   {
     const Eigen::Affine3d& pose = exact_poses_[traj_id];
 
-    // Calculate all possible joint solutions
-    std::vector<std::vector<double>> joint_poses;
-    getAllJointPosesForCartPoint(pose, joint_poses);
+    // Calculate all possible joint solutions, stored next to those of the previous point
+    JointPoseLayer& joint_poses = layer_joint_poses_[traj_id];
+    if (!reuse_joint_poses)
+    {
+      std::vector<std::vector<double>> ik_joint_poses;
+      getAllJointPosesForCartPoint(pose, ik_joint_poses);
+      joint_poses = joint_pose_arena_->copy(ik_joint_poses);
+
+      // Debug:: Show all possible configurations
+      if (false)
+        visualizeAllJointPoses(ik_joint_poses);
+    }
 
     // Handle error: no IK solutions found
-    if (joint_poses.empty())
+    if (joint_poses.num_poses_ == 0)
     {
       ROS_ERROR_STREAM_NAMED(name_, "No joint solutions found for pose " << traj_id);
 
@@ -398,53 +456,73 @@ bool CartPathPlanner::populateBoltGraph(ompl::tools::bolt::TaskGraphPtr task_gra
       // Show last valid pose if possible
       if (traj_id > 0)
       {
-        joint_poses.clear();  // reset vector
-
         // Get the joint poses from the last cartesian point
-        getAllJointPosesForCartPoint(exact_poses_[traj_id - 1], joint_poses);
-        BOOST_ASSERT_MSG(!joint_poses.empty(), "Should not happen - no joint poses found for previous cartesian point");
-        visual_tools_->publishRobotState(joint_poses.front(), jmg_, rvt::RED);
+        const JointPoseLayer& previous_joint_poses = layer_joint_poses_[traj_id - 1];
+        BOOST_ASSERT_MSG(previous_joint_poses.num_poses_ > 0, "Should not happen - no joint poses found for previous "
+                                                              "cartesian point");
+        const double* previous_pose = previous_joint_poses.getPose(0);
+        visual_tools_->publishRobotState(std::vector<double>(previous_pose, previous_pose + previous_joint_poses.dim_),
+                                         jmg_, rvt::RED);
       }
 
+      // Incomplete, so recompute next time
+      layer_joint_poses_.clear();
+      joint_pose_arena_->reset();
       return false;
     }
 
-    // Debug:: Show all possible configurations
-    if (false)
-      visualizeAllJointPoses(joint_poses);
-
     // Convert all possible configurations into the Bolt graph
+    ros::WallTime start_time = ros::WallTime::now();
     if (!addCartPointToBoltGraph(joint_poses, graph_vertices[traj_id], moveit_robot_state))
     {
       ROS_ERROR_STREAM_NAMED(name_, "Failed to add all joint configurations to Bolt graph");
       return false;
     }
+    stats_.add_vertices_time_ += (ros::WallTime::now() - start_time).toSec();
 
     total_vertices += graph_vertices[traj_id].size();
   }
   ROS_DEBUG_STREAM_NAMED(name_, "Generated " << total_vertices << " total vertices in graph");
+  stats_.num_points_ += exact_poses_.size();
+  stats_.num_vertices_ += total_vertices;
+  stats_.ik_buffer_bytes_ = joint_pose_arena_->getCapacityBytes();
 
   ompl::tools::bolt::TaskVertex endingVertex = task_graph_->getNumVertices() - 1;
   //(void)endingVertex;  // prevent unused variable warning
 
   // ---------------------------------------------------------------
   // Add edges
+  ros::WallTime start_time = ros::WallTime::now();
   if (!addEdgesToBoltGraph(graph_vertices, startingVertex, endingVertex))
   {
     ROS_ERROR_STREAM_NAMED(name_, "Error creating edges");
     return false;
   }
+  stats_.add_edges_time_ += (ros::WallTime::now() - start_time).toSec();
+
+  // ---------------------------------------------------------------
+  // Solve the Cartesian layers exactly, before connecting them to the rest of the graph
+  graph_vertices_ = graph_vertices;
+  start_time = ros::WallTime::now();
+  if (!solveCartesianLayers())
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "No feasible path across the Cartesian points");
+    return false;
+  }
+  stats_.solve_layers_time_ += (ros::WallTime::now() - start_time).toSec();
 
   // ---------------------------------------------------------------
   // Connect Descartes graph to Bolt graph
 
-  // Track the shortest straight-line cost across any pair of start/goal points
+  // Track the shortest cost across any pair of start/goal points
   double shortest_path_across_cart = std::numeric_limits<double>::infinity();
+  start_time = ros::WallTime::now();
   if (!connectTrajectoryEndPoints(graph_vertices, shortest_path_across_cart))
   {
     ROS_ERROR_STREAM_NAMED(name_, "Unable to connect trajectory end points!");
     return false;
   }
+  stats_.connect_end_points_time_ += (ros::WallTime::now() - start_time).toSec();
 
   // Set the shortest path across cartesian graph in the TaskGraph
   task_graph_->setShortestDistAcrossCart(shortest_path_across_cart);
@@ -454,10 +532,15 @@ bool CartPathPlanner::populateBoltGraph(ompl::tools::bolt::TaskGraphPtr task_gra
 
   task_graph_->printGraphStats();
 
+  stats_.total_time_ += (ros::WallTime::now() - populate_start_time).toSec();
+  ROS_DEBUG_STREAM_NAMED(name_ + ".timing", "IK " << stats_.ik_time_ << "s, vertices " << stats_.add_vertices_time_
+                                                  << "s, edges " << stats_.add_edges_time_ << "s, connect "
+                                                  << stats_.connect_end_points_time_ << "s");
+
   return true;
 }
 
-bool CartPathPlanner::addCartPointToBoltGraph(const std::vector<std::vector<double>>& joint_poses,
+bool CartPathPlanner::addCartPointToBoltGraph(const JointPoseLayer& joint_poses,
                                               std::vector<ompl::tools::bolt::TaskVertex>& point_vertices,
                                               moveit::core::RobotStatePtr moveit_robot_state)
 {
@@ -468,13 +551,11 @@ bool CartPathPlanner::addCartPointToBoltGraph(const std::vector<std::vector<doub
   const ompl::tools::bolt::VertexType vertex_type = ompl::tools::bolt::CARTESIAN;
   const ompl::tools::bolt::VertexLevel level = 1;  // middle layer
 
-  point_vertices.resize(joint_poses.size());
-  for (std::size_t i = 0; i < joint_poses.size(); ++i)
+  point_vertices.resize(joint_poses.num_poses_);
+  for (std::size_t i = 0; i < joint_poses.num_poses_; ++i)
   {
-    const std::vector<double>& joints_pose = joint_poses[i];
-
-    // Copy vector into moveit format
-    moveit_robot_state->setJointGroupPositions(jmg_, joints_pose);
+    // Copy into moveit format
+    moveit_robot_state->setJointGroupPositions(jmg_, joint_poses.getPose(i));
 
     // Create new OMPL state
     ompl::base::State* ompl_state = space->allocState();
@@ -497,29 +578,40 @@ bool CartPathPlanner::addEdgesToBoltGraph(const TrajectoryGraph& graph_vertices,
                                           ompl::tools::bolt::TaskVertex startingVertex,
                                           ompl::tools::bolt::TaskVertex endingVertex)
 {
+  TRACE_SCOPE("add_cart_edges");
   ROS_INFO_STREAM_NAMED(name_, "addEdgesToBoltGraph()");
   std::size_t indent = 0;
 
-  moveit_ompl::ModelBasedStateSpacePtr space = parent_->space_;
-
   // Iterate to create edges
   std::size_t new_edge_count = 0;
   std::size_t edges_skipped_count = 0;
   const ompl::tools::bolt::EdgeType edge_type = ompl::tools::bolt::eCARTESIAN;
+  feasible_moves_.resize(exact_poses_.size());
 
   // Step through each cartesian point, starting at second point
   for (std::size_t traj_id = 1; traj_id < exact_poses_.size(); ++traj_id)
   {
-    // Get all vertices at this cartesian point
+    // Get all vertices at this cartesian point, and their joint values in the same order
     const std::vector<ompl::tools::bolt::TaskVertex>& point_vertices1 = graph_vertices[traj_id];
+    const JointPoseLayer& joint_poses1 = layer_joint_poses_[traj_id];
+
+    // Get all vertices at previous cartesian point
+    const std::vector<ompl::tools::bolt::TaskVertex>& point_vertices0 = graph_vertices[traj_id - 1];
+    const JointPoseLayer& joint_poses0 = layer_joint_poses_[traj_id - 1];
+
+    // Masks are kept for solveCartesianLayers()
+    std::vector<std::vector<uint64_t>>& layer_feasible_moves = feasible_moves_[traj_id];
+    layer_feasible_moves.resize(point_vertices1.size());
 
     // Step through each vertex in a cartesian point
     for (std::size_t vertex1_id = 0; vertex1_id < point_vertices1.size(); ++vertex1_id)
     {
       ompl::tools::bolt::TaskVertex v1 = point_vertices1[vertex1_id];
 
-      // Get all vertices at previous cartesian point
-      const std::vector<ompl::tools::bolt::TaskVertex>& point_vertices0 = graph_vertices[traj_id - 1];
+      // Attempt to eliminate edges based on the ability to achieve joint motion is possible in the window provided,
+      // for the whole previous point at once
+      std::vector<uint64_t>& feasible_moves = layer_feasible_moves[vertex1_id];
+      velocity_filter_->filterLayer(joint_poses0, joint_poses1.getPose(vertex1_id), feasible_moves);
 
       // Connect to every vertex in *previous* cartesian point
       for (std::size_t vertex0_id = 0; vertex0_id < point_vertices0.size(); ++vertex0_id)
@@ -532,13 +624,7 @@ bool CartPathPlanner::addEdgesToBoltGraph(const TrajectoryGraph& graph_vertices,
         BOOST_ASSERT_MSG(v0 > startingVertex && v0 <= endingVertex, "Attempting to create edge with out of range "
                                                                     "vertex");
 
-        // Convert OMPL state to std::vector
-        const double* start_array =
-            task_graph_->getState(v0)->as<moveit_ompl::ModelBasedStateSpace::StateType>()->values;
-        const double* end_array = task_graph_->getState(v1)->as<moveit_ompl::ModelBasedStateSpace::StateType>()->values;
-
-        // Attempt to eliminate edge based on the ability to achieve joint motion is possible in the window provided
-        if (!ur5_robot_model_->isValidMove(start_array, end_array, space->getDimension(), timing_))
+        if (!JointVelocityFilter::isFeasible(feasible_moves, vertex0_id))
         {
           edges_skipped_count++;
           continue;
@@ -555,6 +641,8 @@ bool CartPathPlanner::addEdgesToBoltGraph(const TrajectoryGraph& graph_vertices,
       exit(0);
   }  // for
   ROS_DEBUG_STREAM_NAMED(name_, "Added " << new_edge_count << " new edges, rejected " << edges_skipped_count);
+  stats_.num_edges_ += new_edge_count;
+  stats_.num_edges_skipped_ += edges_skipped_count;
 
   std::size_t warning_factor = 4;
   if (edges_skipped_count * warning_factor > new_edge_count)
@@ -568,6 +656,7 @@ bool CartPathPlanner::addEdgesToBoltGraph(const TrajectoryGraph& graph_vertices,
 bool CartPathPlanner::connectTrajectoryEndPoints(const TrajectoryGraph& graph_vertices,
                                                  double& shortest_path_across_cart)
 {
+  TRACE_SCOPE("connect_cart_end_points");
   std::size_t indent = 0;
   // force visualization
   // task_graph_->visualizeTaskGraph_ = true;
@@ -576,10 +665,24 @@ bool CartPathPlanner::connectTrajectoryEndPoints(const TrajectoryGraph& graph_ve
   const std::vector<ompl::tools::bolt::TaskVertex>& start_vertices = graph_vertices.front();
   const std::vector<ompl::tools::bolt::TaskVertex>& goal_vertices = graph_vertices.back();
 
+  // Record min cost for cost-to-go heurstic distance function later. This is the exact cost of the best path
+  // across the Descartes graph, much tighter than the straight-line distance between start and goal points
+  shortest_path_across_cart = layered_solver_->getShortestCost();
+
   // Loop through all start points
   ROS_INFO_STREAM_NAMED(name_, "Connecting Cartesian start points to TaskGraph");
-  for (const ompl::tools::bolt::TaskVertex& start_vertex : start_vertices)
+  std::size_t dead_end_count = 0;
+  for (std::size_t start_id = 0; start_id < start_vertices.size(); ++start_id)
   {
+    const ompl::tools::bolt::TaskVertex& start_vertex = start_vertices[start_id];
+
+    // Entering the Cartesian graph at a vertex that can not reach its end would only add work for A*
+    if (layered_solver_->getStartCost(start_id) == std::numeric_limits<double>::infinity())
+    {
+      dead_end_count++;
+      continue;
+    }
+
     // Connect to TaskGraph
     const ompl::tools::bolt::VertexLevel level0 = 0;
     bool isStart = true;
@@ -589,23 +692,14 @@ bool CartPathPlanner::connectTrajectoryEndPoints(const TrajectoryGraph& graph_ve
       return false;  // TODO(davetcoleman): return here?
     }
 
-    // Calculate the shortest straight-line distance across Descartes graph
-    // Record min cost for cost-to-go heurstic distance function later
-    // Check if this start vertex has has the shortest path across the Cartesian graph
-    for (const ompl::tools::bolt::TaskVertex& goal_vertex : goal_vertices)
-    {
-      double distance_across_graph = task_graph_->distanceFunction(start_vertex, goal_vertex);
-
-      if (distance_across_graph < shortest_path_across_cart)
-      {
-        shortest_path_across_cart = distance_across_graph;
-      }
-    }
-
     if (!ros::ok())
       exit(-1);
   }
 
+  if (dead_end_count)
+    ROS_DEBUG_STREAM_NAMED(name_, "Did not connect " << dead_end_count << " of " << start_vertices.size()
+                                                     << " start points that can not reach the end of the path");
+
   // Loop through all goal points
   ROS_INFO_STREAM_NAMED(name_, "Connecting Cartesian end points to TaskGraph");
   for (const ompl::tools::bolt::TaskVertex& goal_vertex : goal_vertices)
@@ -627,14 +721,38 @@ bool CartPathPlanner::connectTrajectoryEndPoints(const TrajectoryGraph& graph_ve
   return true;
 }
 
+bool CartPathPlanner::solveCartesianLayers()
+{
+  TRACE_SCOPE("solve_cart_layers");
+  std::vector<std::size_t> layer_sizes;
+  for (const std::vector<ompl::tools::bolt::TaskVertex>& point_vertices : graph_vertices_)
+    layer_sizes.push_back(point_vertices.size());
+
+  // Same edges that addEdgesToBoltGraph() created, with the task graph's edge cost
+  const double inf = std::numeric_limits<double>::infinity();
+  return layered_solver_->solve(layer_sizes, [this, inf](std::size_t traj_id, std::size_t pose0, std::size_t pose1)
+                                {
+                                  if (!JointVelocityFilter::isFeasible(feasible_moves_[traj_id][pose1], pose0))
+                                    return inf;
+
+                                  return task_graph_->distanceFunction(graph_vertices_[traj_id - 1][pose0],
+                                                                       graph_vertices_[traj_id][pose1]);
+                                });
+}
+
 bool CartPathPlanner::getAllJointPosesForCartPoint(const Eigen::Affine3d& pose,
                                                    std::vector<std::vector<double>>& joint_poses)
 {
+  TRACE_SCOPE("cart_point_ik");
   EigenSTL::vector_Affine3d candidate_poses;
+  ros::WallTime start_time = ros::WallTime::now();
   if (!computeAllPoses(pose, orientation_tol_, candidate_poses))
     return false;
+  stats_.compute_poses_time_ += (ros::WallTime::now() - start_time).toSec();
+  stats_.num_candidate_poses_ += candidate_poses.size();
 
   // Enumerate solvable joint poses for each candidate_pose
+  start_time = ros::WallTime::now();
   for (const Eigen::Affine3d& candidate_pose : candidate_poses)
   {
     std::vector<std::vector<double>> local_joint_poses;
@@ -643,6 +761,7 @@ bool CartPathPlanner::getAllJointPosesForCartPoint(const Eigen::Affine3d& pose,
       joint_poses.insert(joint_poses.end(), local_joint_poses.begin(), local_joint_poses.end());
     }
   }
+  stats_.ik_time_ += (ros::WallTime::now() - start_time).toSec();
   return true;
 }
 
@@ -0,0 +1,163 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Time each stage of Cartesian graph generation over offsets of the Cartesian path and tolerances
+*/
+
+// ROS parameter loading
+#include <rosparam_shortcuts/rosparam_shortcuts.h>
+
+// moveit_ompl
+#include <moveit_ompl/ompl_rosparam.h>
+
+// this package
+#include <curie_demos/cart_pipeline_benchmark.h>
+#include <curie_demos/memory_usage.h>
+
+namespace curie_demos
+{
+CartPipelineBenchmark::CartPipelineBenchmark(CartPathPlannerPtr cart_path_planner,
+                                             ompl::tools::bolt::TaskGraphPtr task_graph)
+  : nh_("~"), cart_path_planner_(cart_path_planner), task_graph_(task_graph)
+{
+  // Load rosparams
+  ros::NodeHandle rpnh(nh_, name_);
+  std::size_t error = 0;
+  error += !rosparam_shortcuts::get(name_, rpnh, "path_offsets", path_offsets_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "orientation_increments", orientation_increments_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "orientation_tolerances", orientation_tolerances_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "repetitions", repetitions_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "output_file", output_file_);
+  rosparam_shortcuts::shutdownIfError(name_, error);
+}
+
+bool CartPipelineBenchmark::run()
+{
+  if (!cart_path_planner_)
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "No Cartesian planner loaded");
+    return false;
+  }
+  if (path_offsets_.empty() || path_offsets_.size() % 3 || orientation_tolerances_.empty() ||
+      orientation_tolerances_.size() % 3 || orientation_increments_.empty())
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "path_offsets and orientation_tolerances must be lists of x, y, z triples, and "
+                                  "orientation_increments must not be empty");
+    return false;
+  }
+
+  std::string file_path;
+  moveit_ompl::getFilePath(file_path, output_file_, "ros/ompl_storage");
+  output_.open(file_path.c_str());
+  if (!output_)
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "Unable to write to " << file_path);
+    return false;
+  }
+  output_ << "path_id,offset_x,offset_y,offset_z,orientation_increment,tol_x,tol_y,tol_z,repetition,success,"
+             "points,candidate_poses,vertices,edges,edges_skipped,transform_path_s,compute_poses_s,ik_s,"
+             "add_vertices_s,add_edges_s,solve_layers_s,connect_end_points_s,total_s,ik_buffer_mb";
+  for (std::size_t i = 0; i < MEMORY_NUM_SUBSYSTEMS; ++i)
+    output_ << "," << MemoryTracker::getSubsystemName(static_cast<MemorySubsystem>(i)) << "_mb";
+  output_ << std::endl;
+
+  // Restore the user's settings afterwards
+  const double original_increment = cart_path_planner_->getOrientationIncrement();
+  const OrientationTol original_tol = cart_path_planner_->getOrientationTol();
+  const Eigen::Affine3d base_pose = cart_path_planner_->getStartPose();
+
+  const std::size_t num_paths = path_offsets_.size() / 3;
+  const std::size_t num_runs =
+      num_paths * orientation_increments_.size() * orientation_tolerances_.size() / 3 * std::max(1, repetitions_);
+  ROS_INFO_STREAM_NAMED(name_, "Benchmarking " << num_runs << " Cartesian graph generations, writing to "
+                                               << file_path);
+
+  for (std::size_t path_id = 0; path_id < num_paths && ros::ok(); ++path_id)
+  {
+    Eigen::Affine3d start_pose = base_pose;
+    start_pose.translation() +=
+        Eigen::Vector3d(path_offsets_[3 * path_id], path_offsets_[3 * path_id + 1], path_offsets_[3 * path_id + 2]);
+
+    for (double orientation_increment : orientation_increments_)
+      for (std::size_t tol_id = 0; tol_id < orientation_tolerances_.size() / 3; ++tol_id)
+      {
+        cart_path_planner_->setOrientationIncrement(orientation_increment);
+        cart_path_planner_->setOrientationTol(OrientationTol(orientation_tolerances_[3 * tol_id],
+                                                             orientation_tolerances_[3 * tol_id + 1],
+                                                             orientation_tolerances_[3 * tol_id + 2]));
+        for (int repetition = 0; repetition < std::max(1, repetitions_) && ros::ok(); ++repetition)
+          runOnce(path_id, start_pose, repetition);
+      }
+  }
+
+  cart_path_planner_->setOrientationIncrement(original_increment);
+  cart_path_planner_->setOrientationTol(original_tol);
+
+  ROS_INFO_STREAM_NAMED(name_, "Finished benchmarking, results in " << file_path);
+  return true;
+}
+
+void CartPipelineBenchmark::runOnce(std::size_t path_id, const Eigen::Affine3d& start_pose, std::size_t repetition)
+{
+  // New poses, so the IK solutions are recomputed every repetition
+  cart_path_planner_->resetStats();
+  cart_path_planner_->generateExactPoses(start_pose);
+
+  const bool success = cart_path_planner_->populateBoltGraph(task_graph_);
+
+  const CartGraphStats& stats = cart_path_planner_->getStats();
+  const std::vector<double>& tol = cart_path_planner_->getOrientationTol().axis_dist_from_center_;
+  output_ << path_id << "," << start_pose.translation().x() << "," << start_pose.translation().y() << ","
+          << start_pose.translation().z() << "," << cart_path_planner_->getOrientationIncrement() << "," << tol[0]
+          << "," << tol[1] << "," << tol[2] << "," << repetition << "," << success << "," << stats.num_points_ << ","
+          << stats.num_candidate_poses_ << "," << stats.num_vertices_ << "," << stats.num_edges_ << ","
+          << stats.num_edges_skipped_ << "," << stats.transform_path_time_ << "," << stats.compute_poses_time_ << ","
+          << stats.ik_time_ << "," << stats.add_vertices_time_ << "," << stats.add_edges_time_ << ","
+          << stats.solve_layers_time_ << "," << stats.connect_end_points_time_ << "," << stats.total_time_ << ","
+          << stats.ik_buffer_bytes_ / 1048576.0;
+
+  // Bytes each subsystem holds for the generated graph. The RSS growth would read about 0 after the first
+  // repetition, as the allocator reuses the memory freed by the previous one
+  for (std::size_t i = 0; i < MEMORY_NUM_SUBSYSTEMS; ++i)
+    output_ << "," << MemoryTracker::getCurrentBytes(static_cast<MemorySubsystem>(i)) / 1048576.0;
+  output_ << std::endl;
+
+  ROS_INFO_STREAM_NAMED(name_, "Path " << path_id << " increment " << cart_path_planner_->getOrientationIncrement()
+                                       << ": " << (success ? "generated " : "failed after ") << stats.num_vertices_
+                                       << " vertices, " << stats.num_edges_ << " edges in " << stats.total_time_
+                                       << "s (IK " << stats.ik_time_ << "s)");
+}
+
+}  // namespace curie_demos
@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Skip collision pairs that cannot change while only one planning group moves
+*/
+
+// C++
+#include <set>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/collision_pair_filter.h>
+
+namespace curie_demos
+{
+namespace
+{
+/** \brief Allow a pair unless it is already allowed or in collision at the reference state */
+bool allowPair(const std::string& name1, const std::string& name2,
+               const std::set<std::pair<std::string, std::string>>& colliding,
+               collision_detection::AllowedCollisionMatrix& acm)
+{
+  collision_detection::AllowedCollision::Type type;
+  if (acm.getEntry(name1, name2, type) && type == collision_detection::AllowedCollision::ALWAYS)
+    return false;
+  if (colliding.count(std::make_pair(name1, name2)) || colliding.count(std::make_pair(name2, name1)))
+    return false;
+
+  acm.setEntry(name1, name2, true);
+  return true;
+}
+}  // namespace
+
+const moveit::core::JointModel* getGroupParentJoint(const moveit::core::LinkModel* link,
+                                                    const moveit::core::JointModelGroup* jmg)
+{
+  for (const moveit::core::JointModel* joint = link->getParentJointModel(); joint;
+       joint = joint->getParentLinkModel() ? joint->getParentLinkModel()->getParentJointModel() : NULL)
+  {
+    if (joint->getType() != moveit::core::JointModel::FIXED && jmg->hasJointModel(joint->getName()))
+      return joint;
+  }
+  return NULL;
+}
+
+std::size_t filterGroupCollisionPairs(const planning_scene::PlanningScene& scene, const std::string& group_name,
+                                      const moveit::core::RobotState& reference_state,
+                                      collision_detection::AllowedCollisionMatrix& acm)
+{
+  const moveit::core::JointModelGroup* jmg = scene.getRobotModel()->getJointModelGroup(group_name);
+  if (!jmg)
+  {
+    ROS_ERROR_STREAM_NAMED("collision_pair_filter", "Unknown planning group " << group_name);
+    return 0;
+  }
+
+  // Find the pairs in collision at the reference state, these must keep being reported
+  collision_detection::CollisionRequest request;
+  request.contacts = true;
+  request.max_contacts = 1000;
+  request.max_contacts_per_pair = 1;
+  collision_detection::CollisionResult result;
+  scene.checkCollision(request, result, reference_state, acm);
+
+  std::set<std::pair<std::string, std::string>> colliding;
+  for (const auto& contact : result.contacts)
+    colliding.insert(contact.first);
+
+  // Every link with geometry and the joint that moves it
+  const std::vector<const moveit::core::LinkModel*>& links = scene.getRobotModel()->getLinkModelsWithCollisionGeometry();
+  std::vector<const moveit::core::JointModel*> parents;
+  for (const moveit::core::LinkModel* link : links)
+    parents.push_back(getGroupParentJoint(link, jmg));
+
+  std::size_t num_allowed = 0;
+  for (std::size_t i = 0; i < links.size(); ++i)
+  {
+    // Rigid with each other
+    for (std::size_t j = i + 1; j < links.size(); ++j)
+      if (parents[i] == parents[j])
+        num_allowed += allowPair(links[i]->getName(), links[j]->getName(), colliding, acm);
+
+    // Rigid with the world
+    if (!parents[i])
+      for (const std::string& object : scene.getWorld()->getObjectIds())
+        num_allowed += allowPair(links[i]->getName(), object, colliding, acm);
+  }
+
+  ROS_INFO_STREAM_NAMED("collision_pair_filter", "Skipping " << num_allowed << " collision pairs that cannot change "
+                                                             "when only " << group_name << " moves, keeping "
+                                                             << colliding.size() << " pairs in collision at the "
+                                                             "reference state");
+  return num_allowed;
+}
+
+}  // namespace curie_demos
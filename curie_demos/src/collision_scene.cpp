@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Build the static environment of the workcell and the scene that collision checks are run against
+*/
+
+// ROS
+#include <ros/ros.h>
+
+// MoveIt
+#include <moveit_visual_tools/moveit_visual_tools.h>
+
+// moveit_ompl
+#include <moveit_ompl/ompl_rosparam.h>
+
+// this package
+#include <curie_demos/collision_scene.h>
+#include <curie_demos/collision_pair_filter.h>
+#include <curie_demos/self_collision_pair_cache.h>
+
+namespace curie_demos
+{
+planning_scene::PlanningSceneConstPtr
+createCollisionScene(const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor,
+                     const std::string& group_name, const moveit::core::RobotState& reference_state, bool freeze,
+                     bool filter_collision_pairs, std::size_t self_collision_samples, boost::uint32_t seed,
+                     planning_scene::PlanningSceneConstPtr* validation_scene)
+{
+  // Add a collision objects
+  moveit_visual_tools::MoveItVisualTools scene_visual("world", ros::this_node::getName() + "/scene_markers",
+                                                      planning_scene_monitor);
+  scene_visual.setManualSceneUpdating(true);
+  scene_visual.publishCollisionFloor(0.001, "floor", rviz_visual_tools::TRANSLUCENT_DARK);
+  scene_visual.publishCollisionWall(-0.3, 0.0, 0, 2, 1.5, "wall", rviz_visual_tools::BLACK);
+  scene_visual.triggerPlanningSceneUpdate();
+  ros::spinOnce();
+
+  if (!freeze)
+  {
+    if (validation_scene)
+      *validation_scene = planning_scene_monitor->getPlanningScene();
+    return planning_scene_monitor->getPlanningScene();
+  }
+
+  // The environment does not change from here on. Copy the world, its broadphase and the allowed collision matrix
+  // into a standalone scene that nothing writes to, so the checker threads can read it without the monitor's
+  // lock and without walking a chain of scene diffs. Later updates to the monitored scene, e.g. from the
+  // interactive markers, are only seen by Rviz
+  planning_scene::PlanningScenePtr frozen_scene;
+  {
+    planning_scene_monitor::LockedPlanningSceneRO scene(planning_scene_monitor);
+    frozen_scene = scene->diff();
+  }
+  frozen_scene->decoupleParent();
+  frozen_scene->setName("frozen_scene");
+
+  // Only the planning group moves from here on, so pairs that move rigidly together need no narrow phase
+  if (filter_collision_pairs)
+    filterGroupCollisionPairs(*frozen_scene, group_name, reference_state,
+                              frozen_scene->getAllowedCollisionMatrixNonConst());
+
+  // Sampled pairs are not proven to stay in or out of collision as the group moves, so solutions are validated in
+  // a copy of the scene without any of them
+  if (validation_scene)
+  {
+    if (self_collision_samples > 0)
+    {
+      planning_scene::PlanningScenePtr checked_scene = frozen_scene->diff();
+      checked_scene->decoupleParent();
+      checked_scene->setName("validation_scene");
+      *validation_scene = checked_scene;
+    }
+    else
+      *validation_scene = frozen_scene;
+  }
+
+  // Self collision pairs of the group that always or never collide, sampled once and kept with the database
+  if (self_collision_samples > 0)
+  {
+    std::string file_path;
+    moveit_ompl::getFilePath(file_path, "self_collision_" + group_name, "ros/ompl_storage");
+
+    SelfCollisionPairCache self_collision_cache(group_name);
+    bool have_pairs =
+        self_collision_cache.load(file_path, *frozen_scene, reference_state, self_collision_samples, seed);
+    if (!have_pairs && self_collision_cache.compute(*frozen_scene, reference_state, self_collision_samples, seed))
+    {
+      have_pairs = true;
+      self_collision_cache.save(file_path);
+    }
+
+    if (have_pairs)
+      self_collision_cache.apply(frozen_scene->getAllowedCollisionMatrixNonConst());
+  }
+
+  ROS_INFO_STREAM_NAMED("collision_scene", "Froze the planning scene with " << frozen_scene->getWorld()->size()
+                                                                            << " collision objects");
+  return frozen_scene;
+}
+
+}  // namespace curie_demos
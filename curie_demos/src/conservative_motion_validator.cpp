@@ -0,0 +1,274 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Motion validator that uses obstacle clearance to take large steps along an edge
+*/
+
+// C++
+#include <algorithm>
+#include <limits>
+
+// ROS
+#include <ros/ros.h>
+
+// MoveIt
+#include <geometric_shapes/shape_operations.h>
+
+// this package
+#include <curie_demos/conservative_motion_validator.h>
+#include <curie_demos/metrics.h>
+
+namespace curie_demos
+{
+ConservativeMotionValidator::ConservativeMotionValidator(const ompl::base::SpaceInformationPtr &si,
+                                                         moveit_ompl::ModelBasedStateSpacePtr space,
+                                                         planning_scene::PlanningSceneConstPtr planning_scene)
+  : ompl::base::MotionValidator(si)
+  , space_(space)
+  , planning_scene_(planning_scene)
+  , tss_(planning_scene->getCurrentState())
+  , num_checks_(0)
+{
+  distance_request_.group_name = space_->getJointModelGroup()->getName();
+  distance_request_.distance = true;
+
+  computeLipschitzBounds();
+}
+
+bool ConservativeMotionValidator::checkMotion(const ompl::base::State *s1, const ompl::base::State *s2) const
+{
+  return checkMotionImpl(s1, s2, NULL);
+}
+
+bool ConservativeMotionValidator::checkMotion(const ompl::base::State *s1, const ompl::base::State *s2,
+                                              std::pair<ompl::base::State *, double> &last_valid) const
+{
+  return checkMotionImpl(s1, s2, &last_valid);
+}
+
+void ConservativeMotionValidator::computeLipschitzBounds()
+{
+  const moveit::core::JointModelGroup *jmg = space_->getJointModelGroup();
+
+  for (const moveit::core::JointModel *joint : jmg->getActiveJointModels())
+  {
+    if (joint->getVariableCount() != 1)
+    {
+      ROS_WARN_STREAM_NAMED(name_, "Joint " << joint->getName() << " has multiple variables, falling back to "
+                                                                   "discrete motion checking");
+      supported_ = false;
+      return;
+    }
+    joints_.push_back(joint);
+    joint_variable_index_.push_back(jmg->getVariableGroupIndex(joint->getVariableNames()[0]));
+
+    // A revolute joint moves a point by its distance from the axis times the rotation, a prismatic joint
+    // moves every point by exactly the joint motion
+    double bound = 1.0;
+    if (joint->getType() == moveit::core::JointModel::REVOLUTE)
+      bound = getDescendantExtent(joint->getChildLinkModel());
+    lipschitz_bounds_.push_back(bound);
+
+    ROS_DEBUG_STREAM_NAMED(name_, "Lipschitz bound of joint " << joint->getName() << ": " << bound);
+  }
+}
+
+double ConservativeMotionValidator::getDescendantExtent(const moveit::core::LinkModel *link) const
+{
+  // Geometry of this link, measured from its origin
+  double extent = 0.0;
+  const std::vector<shapes::ShapeConstPtr> &shapes = link->getShapes();
+  const EigenSTL::vector_Affine3d &origins = link->getCollisionOriginTransforms();
+  for (std::size_t i = 0; i < shapes.size(); ++i)
+  {
+    Eigen::Vector3d center;
+    double radius;
+    shapes::computeShapeBoundingSphere(shapes[i].get(), center, radius);
+    extent = std::max(extent, (origins[i] * center).norm() + radius);
+  }
+
+  // Descendants, measured through the chain so the bound holds for any joint configuration
+  for (const moveit::core::JointModel *child_joint : link->getChildJointModels())
+  {
+    const moveit::core::LinkModel *child_link = child_joint->getChildLinkModel();
+    double offset = child_link->getJointOriginTransform().translation().norm();
+    if (child_joint->getType() == moveit::core::JointModel::PRISMATIC)
+      offset += std::max(std::abs(child_joint->getVariableBounds()[0].min_position_),
+                         std::abs(child_joint->getVariableBounds()[0].max_position_));
+    extent = std::max(extent, offset + getDescendantExtent(child_link));
+  }
+
+  return extent;
+}
+
+bool ConservativeMotionValidator::checkState(const ompl::base::State *state, double &world_distance,
+                                             double &self_distance, bool &has_attached_bodies) const
+{
+  num_checks_++;
+  Metrics::getValidityChecksCounter().increment();
+  if (!si_->satisfiesBounds(state))
+    return false;
+
+  moveit::core::RobotState *robot_state = tss_.getStateStorage();
+  space_->copyToRobotState(*robot_state, state);
+  if (!planning_scene_->isStateFeasible(*robot_state))
+    return false;
+  robot_state->updateCollisionBodyTransforms();
+
+  std::vector<const moveit::core::AttachedBody *> attached_bodies;
+  robot_state->getAttachedBodies(attached_bodies);
+  has_attached_bodies = !attached_bodies.empty();
+
+  // Same checks as PlanningScene::checkCollision(), but keeping both distances
+  const collision_detection::AllowedCollisionMatrix &acm = planning_scene_->getAllowedCollisionMatrix();
+  collision_detection::CollisionResult res;
+  planning_scene_->getCollisionWorld()->checkRobotCollision(distance_request_, res,
+                                                            *planning_scene_->getCollisionRobot(), *robot_state, acm);
+  if (res.collision)
+  {
+    Metrics::getValidityCollisionsCounter().increment();
+    return false;
+  }
+  world_distance = res.distance;
+
+  res.clear();
+  planning_scene_->getCollisionRobotUnpadded()->checkSelfCollision(distance_request_, res, *robot_state, acm);
+  if (res.collision)
+  {
+    Metrics::getValidityCollisionsCounter().increment();
+    return false;
+  }
+  self_distance = res.distance;
+
+  return true;
+}
+
+double ConservativeMotionValidator::getMaxDisplacement(const ompl::base::State *s1,
+                                                       const ompl::base::State *s2) const
+{
+  const double *values1 = s1->as<moveit_ompl::ModelBasedStateSpace::StateType>()->values;
+  const double *values2 = s2->as<moveit_ompl::ModelBasedStateSpace::StateType>()->values;
+
+  // Joints near the tip move little geometry, so weighting each joint separately gives much larger steps
+  // than a single bound for the whole arm
+  double displacement = 0.0;
+  for (std::size_t i = 0; i < joints_.size(); ++i)
+  {
+    const std::size_t index = joint_variable_index_[i];
+    displacement += lipschitz_bounds_[i] * joints_[i]->distance(&values1[index], &values2[index]);
+  }
+
+  return displacement;
+}
+
+bool ConservativeMotionValidator::checkMotionImpl(const ompl::base::State *s1, const ompl::base::State *s2,
+                                                  std::pair<ompl::base::State *, double> *last_valid) const
+{
+  // Check the end state first, the most likely to be invalid
+  double world_distance, self_distance;
+  bool has_attached_bodies;
+  if (!checkState(s2, world_distance, self_distance, has_attached_bodies))
+  {
+    invalid_++;
+    if (last_valid)  // without walking the edge, only s1 is known to be valid
+    {
+      if (last_valid->first)
+        si_->copyState(last_valid->first, s1);
+      last_valid->second = 0.0;
+    }
+    return false;
+  }
+
+  // Smallest step, as a fraction of the edge, that the discrete validator would take
+  const double edge_length = si_->distance(s1, s2);
+  const double resolution = si_->getStateValidityCheckingResolution() * si_->getMaximumExtent();
+  if (edge_length <= resolution)
+  {
+    valid_++;
+    return true;
+  }
+  const double min_step = resolution / edge_length;
+
+  // How far the robot can move over the whole edge
+  const double displacement = supported_ ? getMaxDisplacement(s1, s2) : std::numeric_limits<double>::infinity();
+
+  ompl::base::State *state = si_->allocState();
+  si_->copyState(state, s1);
+  double t = 0.0;
+  double last_valid_t = 0.0;
+  bool result = true;
+  while (true)
+  {
+    if (!checkState(state, world_distance, self_distance, has_attached_bodies))
+    {
+      result = false;
+      break;
+    }
+    last_valid_t = t;
+
+    // Links of the robot may approach each other at twice the speed of any single point
+    const double clearance = std::min(world_distance, self_distance / 2.0);
+
+    // Anything other than a positive clearance gives no guarantee, nor do the bounds cover attached bodies, so
+    // take the minimum step
+    double step = min_step;
+    if (clearance > 0.0 && displacement > 0.0 && !has_attached_bodies)
+      step = std::max(step, clearance / displacement);
+
+    t += step;
+    if (t >= 1.0)  // s2 was already checked
+      break;
+
+    space_->interpolate(s1, s2, t, state);
+  }
+
+  if (result)
+    valid_++;
+  else
+  {
+    invalid_++;
+    if (last_valid)
+    {
+      if (last_valid->first)
+        space_->interpolate(s1, s2, last_valid_t, last_valid->first);
+      last_valid->second = last_valid_t;
+    }
+  }
+
+  si_->freeState(state);
+  return result;
+}
+
+}  // namespace curie_demos
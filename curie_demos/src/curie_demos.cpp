@@ -39,10 +39,14 @@
 // Interface for loading rosparam settings into OMPL
 #include <moveit_ompl/ompl_rosparam.h>
 
+// MoveIt
+#include <moveit/collision_detection/collision_tools.h>
+
 // ROS parameter loading
 #include <rosparam_shortcuts/rosparam_shortcuts.h>
 
 #include <ompl_visual_tools/projection_viz_window.h>
+#include <ompl/base/DiscreteMotionValidator.h>
 
 // this package
 #include <curie_demos/curie_demos.h>
@@ -65,6 +69,7 @@ CurieDemos::CurieDemos(const std::string &hostname, const std::string &package_p
   CALLGRIND_TOGGLE_COLLECT;
 
   bool seed_random;
+  int random_seed;
   // Load rosparams
   ros::NodeHandle rpnh(nh_, name_);
   std::size_t error = 0;
@@ -77,6 +82,7 @@ CurieDemos::CurieDemos(const std::string &hostname, const std::string &package_p
   error += !rosparam_shortcuts::get(name_, rpnh, "check_valid_vertices", check_valid_vertices_);
   error += !rosparam_shortcuts::get(name_, rpnh, "display_disjoint_sets", display_disjoint_sets_);
   error += !rosparam_shortcuts::get(name_, rpnh, "benchmark_performance", benchmark_performance_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "benchmark_cartesian", benchmark_cartesian_);
 
   // run type
   error += !rosparam_shortcuts::get(name_, rpnh, "auto_run", auto_run_);
@@ -88,10 +94,21 @@ CurieDemos::CurieDemos(const std::string &hostname, const std::string &package_p
   error += !rosparam_shortcuts::get(name_, rpnh, "planning_group_name", planning_group_name_);
   error += !rosparam_shortcuts::get(name_, rpnh, "ee_tip_link", ee_tip_link_);
   error += !rosparam_shortcuts::get(name_, rpnh, "seed_random", seed_random);
+  error += !rosparam_shortcuts::get(name_, rpnh, "random_seed", random_seed);
   error += !rosparam_shortcuts::get(name_, rpnh, "post_processing", post_processing_);
   error += !rosparam_shortcuts::get(name_, rpnh, "post_processing_interval", post_processing_interval_);
   error += !rosparam_shortcuts::get(name_, rpnh, "use_logging", use_logging_);
   error += !rosparam_shortcuts::get(name_, rpnh, "collision_checking_enabled", collision_checking_enabled_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "background_save", background_save_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "sampling_threads", sampling_threads_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "reservoir_max_failed_attempts", reservoir_max_failed_attempts_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "continuous_motion_validation", continuous_motion_validation_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "track_memory_consumption", track_memory_consumption_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "record_trace", record_trace_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "metrics_period", metrics_period_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "freeze_planning_scene", freeze_planning_scene_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "filter_collision_pairs", filter_collision_pairs_);
+  error += !rosparam_shortcuts::get(name_, rpnh, "self_collision_samples", self_collision_samples_);
   // Visualize
   error += !rosparam_shortcuts::get(name_, rpnh, "visualize/display_database", visualize_display_database_);
   error += !rosparam_shortcuts::get(name_, rpnh, "visualize/interpolated_traj", visualize_interpolated_traj_);
@@ -111,9 +128,34 @@ CurieDemos::CurieDemos(const std::string &hostname, const std::string &package_p
   if (headless_)
     OMPL_WARN("Running in headless mode");
 
-  // Seed random
-  if (seed_random)
-    srand(time(NULL));
+  // The sampling threads check collisions without the monitor's lock, which is only safe on a frozen copy
+  if (!freeze_planning_scene_ && sampling_threads_ != 1)
+  {
+    ROS_WARN_STREAM_NAMED(name_, "Parallel sampling requires freeze_planning_scene, freezing the planning scene");
+    freeze_planning_scene_ = true;
+  }
+
+  // Seed random - one master seed that all other random streams are derived from
+  master_seed_ = seed_random ? time(NULL) : std::max(1, random_seed);  // OMPL does not accept a seed of 0
+  ROS_INFO_STREAM_NAMED(name_, "Master random seed: " << master_seed_);
+  srand(master_seed_);
+  ompl::RNG::setSeed(master_seed_);
+  rng_.reset(new random_numbers::RandomNumberGenerator(deriveStreamSeed(master_seed_, 0)));
+
+  // Record memory use of each phase for the summary at the end of the run
+  MemoryTracker::setEnabled(track_memory_consumption_);
+  MemoryTracker::beginPhase("init");
+
+  // Record trace events of the major phases for chrome://tracing
+  Tracer::setEnabled(record_trace_);
+
+  // Live view of the metrics while the long phases run
+  if (metrics_period_ > 0.0)
+  {
+    std::string metrics_file_path;
+    moveit_ompl::getFilePath(metrics_file_path, "curie_demos_metrics.prom", "ros/ompl_storage");
+    metrics_publisher_.reset(new MetricsPublisher(nh_, metrics_period_, metrics_file_path));
+  }
 
   // Initialize MoveIt base
   MoveItBase::init(nh_);
@@ -126,35 +168,35 @@ CurieDemos::CurieDemos(const std::string &hostname, const std::string &package_p
   jmg_ = robot_model_->getJointModelGroup(planning_group_name_);
   ee_link_ = robot_model_->getLinkModel(ee_tip_link_);
 
+  // Everything that checks collisions is created after this, using collision_scene_
+  loadStaticEnvironment();
+
   // Load planning
+  MemoryTracker::beginPhase("load_ompl");
   if (!loadOMPL())
   {
     ROS_ERROR_STREAM_NAMED(name_, "Unable to load planning context");
     exit(-1);
   }
 
+  // Random valid states, checked against the whole robot
+  random_state_sampler_.reset(
+      new BatchStateSampler(space_, collision_scene_, *current_state_, deriveStreamSeed(master_seed_, 2)));
+  random_state_sampler_->setMaxEmptyBatches(8);  // ~1000 attempts
+
   // Load more visual tool objects
+  MemoryTracker::beginPhase("load_visual_tools");
   loadVisualTools();
 
-  // Add a collision objects
-  visual_moveit_start_->publishCollisionFloor(0.001, "floor", rvt::TRANSLUCENT_DARK);
-  visual_moveit_start_->publishCollisionWall(-0.3, 0.0, 0, 2, 1.5, "wall", rvt::BLACK);
-  visual_moveit_start_->triggerPlanningSceneUpdate();
-  ros::spinOnce();
+  // Create start/goal state imarker
+  MemoryTracker::beginPhase("load_interactive_markers");
 
-  // if (track_memory_consumption_)
-  // {
-  //   double vm1, rss1;
-  //   processMemUsage(vm1, rss1);
-  //   ROS_INFO_STREAM_NAMED(name_, "Current memory consumption - VM: " << vm1 << " MB | RSS: " << rss1 << " MB");
-  // }
+  // Create cartesian planner, also headless when benchmarking it
+  if (!headless_ || benchmark_cartesian_)
+    cart_path_planner_.reset(new CartPathPlanner(this));
 
-  // Create start/goal state imarker
   if (!headless_)
   {
-    // Create cartesian planner
-    cart_path_planner_.reset(new CartPathPlanner(this));
-
     imarker_start_.reset(
         new mvt::IMarkerRobotState(planning_scene_monitor_, "start", jmg_, ee_link_, rvt::GREEN, package_path_));
     imarker_goal_.reset(
@@ -178,6 +220,12 @@ CurieDemos::CurieDemos(const std::string &hostname, const std::string &package_p
 
 CurieDemos::~CurieDemos()
 {
+  // Finish writing the database before any of its memory is freed
+  background_saver_.reset();
+
+  // Stop the producer threads, OMPL's sampler allocator may keep the reservoir itself alive longer
+  state_reservoir_->stop();
+
   // Free start and goal states
   space_->freeState(ompl_start_);
   space_->freeState(ompl_goal_);
@@ -185,6 +233,7 @@ CurieDemos::~CurieDemos()
 
 bool CurieDemos::loadOMPL()
 {
+  TRACE_SCOPE("load_ompl");
   moveit_ompl::ModelBasedStateSpaceSpecification mbss_spec(robot_model_, jmg_);
 
   // Construct the state space we are planning in
@@ -212,6 +261,9 @@ bool CurieDemos::loadOMPL()
   // Load collision checker
   loadCollisionChecker();
 
+  // Must be set before setup() so the sparse generator allocates the parallel version
+  loadStateReservoir();
+
   // Setup base OMPL stuff. Do this before choosing filename so sparseDeltaFraction is ready
   ROS_INFO_STREAM_NAMED(name_, "Setting up Bolt");
   experience_setup_->setup();
@@ -230,6 +282,10 @@ bool CurieDemos::loadOMPL()
   moveit_ompl::getFilePath(file_path, file_name, "ros/ompl_storage");
   experience_setup_->setFilePath(file_path);  // this is here because its how we do it in moveit_ompl
 
+  // Persist the database on a worker thread
+  if (background_save_)
+    background_saver_.reset(new BackgroundSaver(experience_setup_));
+
   // Create start and goal states
   ompl_start_ = space_->allocState();
   ompl_goal_ = space_->allocState();
@@ -239,12 +295,8 @@ bool CurieDemos::loadOMPL()
 
 bool CurieDemos::loadData()
 {
-  // double vm1, rss1;
-  // if (track_memory_consumption_)  // Track memory usage
-  // {
-  //   processMemUsage(vm1, rss1);
-  //   // ROS_INFO_STREAM_NAMED(name_, "Current memory consumption - VM: " << vm1 << " MB | RSS: " << rss1 << " MB");
-  // }
+  MemoryTracker::beginPhase("load_roadmap");
+  TRACE_SCOPE("load_roadmap");
 
   // Load database or generate new roadmap
   ROS_INFO_STREAM_NAMED(name_, "Loading or generating roadmap");
@@ -257,13 +309,7 @@ bool CurieDemos::loadData()
     }
   }
 
-  // if (track_memory_consumption_)  // Track memory usage
-  // {
-  //   double vm2, rss2;
-  //   processMemUsage(vm2, rss2);
-  //   // ROS_INFO_STREAM_NAMED(name_, "Current memory consumption - VM: " << vm2 << " MB | RSS: " << rss2 << " MB");
-  //   ROS_INFO_STREAM_NAMED(name_, "RAM usage diff - VM: " << vm2 - vm1 << " MB | RSS: " << rss2 - rss1 << " MB");
-  // }
+  MemoryTracker::endPhase();
 
   return true;
 }
@@ -292,8 +338,16 @@ void CurieDemos::run()
   // Create SPARS
   if (create_spars_ && (!loaded || continue_spars_))
   {
-    bolt_->getSparseGenerator()->createSPARS();
+    MemoryTracker::beginPhase("create_sparse_graph");
+    {
+      TRACE_SCOPE("create_sparse_graph");
+      bolt_->getSparseGenerator()->createSPARS();
+    }
+    MemoryTracker::endPhase();
     loaded = true;
+
+    // Checkpoint the new roadmap while the rest of the setup continues
+    saveDatabase();
   }
 
   if (!loaded)
@@ -310,6 +364,22 @@ void CurieDemos::run()
     bolt_->getSparseGraph()->visualizeDisjointSets(disjointSets);
   }
 
+  // Time each stage of Cartesian graph generation against the loaded roadmap
+  if (benchmark_cartesian_)
+  {
+    waitForDatabaseSave();
+    if (!is_bolt_)
+      ROS_ERROR_STREAM_NAMED(name_, "Benchmarking the Cartesian planner requires the Bolt planner");
+    else
+    {
+      CartPipelineBenchmark benchmark(cart_path_planner_, bolt_->getTaskGraph());
+      benchmark.run();
+    }
+    saveTrace();
+    ROS_INFO_STREAM_NAMED(name_, "Finished benchmarking");
+    exit(0);
+  }
+
   // Repair missing coverage in the dense graph
   // if (eliminate_dense_disjoint_sets_)
   // {
@@ -328,13 +398,21 @@ void CurieDemos::run()
     ROS_INFO_STREAM("Solving requested to be skipped by config file");
   else
   {
+    MemoryTracker::beginPhase("run_problems");
     runProblems();
+    MemoryTracker::endPhase();
     // runPopularityExperiement();
     // runSparseFactorExperiment();
   }
   // testConnectionToGraphOfRandStates();
 
-  bolt_->saveIfChanged();
+  saveDatabase();
+  waitForDatabaseSave();
+
+  MemoryTracker::printSummary();
+  saveTrace();
+  if (metrics_publisher_)
+    metrics_publisher_->update();
 }
 
 bool CurieDemos::runProblems()
@@ -365,11 +443,22 @@ bool CurieDemos::runProblems()
     // Generate start/goal pair
     if (problem_type_ == 0)
     {
-      imarker_start_->setToRandomState();
-      imarker_goal_->setToRandomState();
+      // Random problems come pre-validated from the reservoir
+      if (!state_reservoir_->take(*moveit_start_) || !state_reservoir_->take(*moveit_goal_))
+      {
+        ROS_ERROR_STREAM_NAMED(name_, "Unable to generate random start/goal pair");
+        break;
+      }
+    }
+    else
+    {
+      moveit_start_ = imarker_start_->getRobotState();
+      moveit_goal_ = imarker_goal_->getRobotState();
     }
-    moveit_start_ = imarker_start_->getRobotState();
-    moveit_goal_ = imarker_goal_->getRobotState();
+
+    // The previous run's checkpoint must finish before the database is used again. Both the visualization and the
+    // Cartesian graph below touch the graphs being serialized
+    waitForDatabaseSave();
 
     // Visualize
     if (visualize_start_goal_states_)
@@ -405,6 +494,9 @@ bool CurieDemos::runProblems()
       experience_setup_->doPostProcessing();
     }
 
+    // Checkpoint in the background while the results are displayed and the next problem is set up
+    saveDatabase();
+
     if (visualize_wait_between_plans_ && run_id < planning_runs_ - 1)
       waitForNextStep("run next problem");
     else  // Main pause between planning instances - allows user to analyze
@@ -418,13 +510,17 @@ bool CurieDemos::runProblems()
       deleteAllMarkers(false);
   }  // for each run
 
+  // Report the check of the last solution
+  waitForPathCheck();
+
   // Save experience
+  waitForDatabaseSave();
   if (post_processing_)
     experience_setup_->doPostProcessing();
 
   // Finishing up
   ROS_INFO_STREAM_NAMED(name_, "Saving experience db...");
-  experience_setup_->saveIfChanged();
+  saveDatabase();
 
   // Stats
   if (total_runs_ > 0)
@@ -435,6 +531,8 @@ bool CurieDemos::runProblems()
 
 bool CurieDemos::plan()
 {
+  TRACE_SCOPE("plan");
+
   // Setup -----------------------------------------------------------
 
   // Clear all planning data. This only includes data generated by motion plan computation.
@@ -465,14 +563,28 @@ bool CurieDemos::plan()
   ros::Time start_time = ros::Time::now();
 
   // Attempt to solve the problem within x seconds of planning time
-  ob::PlannerStatus solved = experience_setup_->solve(ptc);
+  ob::PlannerStatus solved;
+  {
+    TRACE_SCOPE("solve");
+    solved = experience_setup_->solve(ptc);
+  }
 
   // Benchmark runtime
   total_duration_ = (ros::Time::now() - start_time).toSec();
 
+  static MetricCounter &solves = Metrics::getCounter("curie_demos_solves_total", "Planning problems attempted");
+  static MetricCounter &failures = Metrics::getCounter("curie_demos_solve_failures_total", "Problems not solved");
+  static MetricHistogram &solve_seconds = Metrics::getHistogram(
+      "curie_demos_solve_seconds", "Time to solve", Metrics::getSecondsBounds());
+  solves.increment();
+  solve_seconds.observe(total_duration_);
+
   // Check for error
   if (!solved)
   {
+    failures.increment();
+    if (metrics_publisher_)
+      metrics_publisher_->update();
     ROS_ERROR_STREAM_NAMED(name_, "No solution found");
     exit(-1);
     return false;
@@ -487,6 +599,7 @@ bool CurieDemos::plan()
   // Check/test the solution for errors
   if (use_task_planning_)
   {
+    TRACE_SCOPE("check_task_path");
     bolt_->getTaskGraph()->checkTaskPathSolution(path, ompl_start_, ompl_goal_);
   }
 
@@ -495,13 +608,8 @@ bool CurieDemos::plan()
   // path.interpolate();
   // ROS_INFO_STREAM_NAMED(name_, "Interpolation added: " << path.getStateCount() - state_count << " states");
 
-  // Convert trajectory
-  robot_trajectory::RobotTrajectoryPtr traj;
-  const double speed = 0.025;
-  viz3_->convertPath(path, jmg_, traj, speed);
-
-  // Check/test the solution for errors
-  checkMoveItPathSolution(traj);
+  // Check/test the solution for errors, streaming it rather than converting to a full trajectory
+  checkOMPLPathSolution(path);
 
   // Visualize the trajectory
   // if (visualize_interpolated_traj_)
@@ -525,11 +633,21 @@ bool CurieDemos::plan()
   return true;
 }
 
+void CurieDemos::loadStaticEnvironment()
+{
+  TRACE_SCOPE("load_static_environment");
+  // A negative sample count disables the self collision cache like 0
+  collision_scene_ = createCollisionScene(planning_scene_monitor_, planning_group_name_, *current_state_,
+                                          freeze_planning_scene_, filter_collision_pairs_,
+                                          std::max(0, self_collision_samples_), deriveStreamSeed(master_seed_, 3),
+                                          &validation_scene_);
+}
+
 void CurieDemos::loadCollisionChecker()
 {
   // Create state validity checking for this space
   validity_checker_ =
-      new moveit_ompl::StateValidityChecker(planning_group_name_, si_, *current_state_, planning_scene_, space_);
+      new moveit_ompl::StateValidityChecker(planning_group_name_, si_, *current_state_, collision_scene_, space_);
   validity_checker_->setCheckingEnabled(collision_checking_enabled_);
 
   // Set checker
@@ -538,6 +656,41 @@ void CurieDemos::loadCollisionChecker()
   // The interval in which obstacles are checked for between states
   // seems that it default to 0.01 but doesn't do a good job at that level
   si_->setStateValidityCheckingResolution(0.005);
+
+  // Checks solution trajectories in parallel
+  path_validator_.reset(new PathValidator(validation_scene_, PathStreamerPtr(new PathStreamer(space_))));
+
+  // Use clearance to skip the free portions of edges, the resolution above is then only the minimum step. It
+  // checks collisions itself, so is not used when checking is disabled for debugging
+  if (continuous_motion_validation_ && collision_checking_enabled_)
+  {
+    motion_validator_.reset(new ConservativeMotionValidator(si_, space_, collision_scene_));
+    si_->setMotionValidator(motion_validator_);
+  }
+}
+
+void CurieDemos::loadStateReservoir()
+{
+  // Background producers of valid states, checked the same way as the validity checker
+  const std::size_t num_threads = sampling_threads_ < 0 ? 0 : sampling_threads_;
+  state_reservoir_.reset(new StateReservoir(space_, collision_scene_, *current_state_, deriveStreamSeed(master_seed_, 1),
+                                            planning_group_name_, collision_checking_enabled_, num_threads));
+  state_reservoir_->setMaxFailedAttempts(std::max(0, reservoir_max_failed_attempts_));
+
+  if (sampling_threads_ == 1)
+  {
+    ROS_INFO_STREAM_NAMED(name_, "Using single threaded valid state sampling");
+    return;
+  }
+
+  // Samplers allocated by OMPL (e.g. for the sparse generator) take their states from the reservoir
+  StateReservoirPtr reservoir = state_reservoir_;
+  si_->setValidStateSamplerAllocator([reservoir](const ob::SpaceInformation *si)
+                                     {
+                                       return ob::ValidStateSamplerPtr(new ParallelValidStateSampler(si, reservoir));
+                                     });
+  ROS_INFO_STREAM_NAMED(name_, "Using parallel valid state sampling with " << state_reservoir_->getNumThreads()
+                                                                           << " threads");
 }
 
 void CurieDemos::deleteAllMarkers(bool clearDatabase)
@@ -725,7 +878,8 @@ void CurieDemos::testConnectionToGraphOfRandStates()
     ROS_INFO_STREAM_NAMED(name_, "Testing random state " << run_id);
 
     // Generate random state
-    getRandomState(moveit_start_);
+    if (!getRandomState(moveit_start_))
+      break;
 
     // Visualize
     visual_moveit_start_->publishRobotState(moveit_start_, rvt::GREEN);
@@ -753,7 +907,10 @@ void CurieDemos::visualizeRawTrajectory(og::PathGeometric &path)
   // Convert trajectory
   robot_trajectory::RobotTrajectoryPtr traj;
   const double speed = 0.05;
-  viz3_->convertPath(path, jmg_, traj, speed);
+  {
+    TRACE_SCOPE("convert_path");
+    viz3_->convertPath(path, jmg_, traj, speed);
+  }
 
   // Show trajectory line
   viz3_->getVisualTools()->publishTrajectoryLine(traj, ee_link_, rvt::GREY);
@@ -779,118 +936,194 @@ bool CurieDemos::generateCartGraph()
   return true;
 }
 
-bool CurieDemos::checkMoveItPathSolution(robot_trajectory::RobotTrajectoryPtr traj)
+bool CurieDemos::checkOMPLPathSolution(og::PathGeometric &path)
 {
-  std::size_t state_count = traj->getWayPointCount();
+  std::size_t state_count = path.getStateCount();
   if (state_count < 3)
-    ROS_WARN_STREAM_NAMED(name_, "checkMoveItPathSolution: Solution path has only " << state_count << " states");
+    ROS_WARN_STREAM_NAMED(name_, "checkOMPLPathSolution: Solution path has only " << state_count << " states");
   else
-    ROS_INFO_STREAM_NAMED(name_, "checkMoveItPathSolution: Solution path has " << state_count << " states");
+    ROS_INFO_STREAM_NAMED(name_, "checkOMPLPathSolution: Solution path has " << state_count << " states");
 
-  std::vector<std::size_t> index;
-  const bool verbose = true;
-  if (!planning_scene_->isPathValid(*traj, "", verbose, &index))
+  // Report the previous check before starting this one
+  waitForPathCheck();
+
+  // The live scene is written by the monitor's callbacks while the workers read it, so check a snapshot
+  if (!freeze_planning_scene_)
   {
-    if (index.size() == 1 && index[0] == 0)  // ignore cases when the robot starts at invalid location
-      ROS_DEBUG("It appears the robot is starting at an invalid state, but that is ok.");
-    else
+    planning_scene::PlanningScenePtr snapshot;
     {
-      // display error messages
-      std::stringstream ss;
-      for (std::size_t i = 0; i < index.size(); ++i)
-        ss << index[i] << " ";
-      ROS_ERROR_STREAM_NAMED(
-          name_, "checkMoveItPathSolution: Computed path is not valid. Invalid states at index locations: [ "
-                     << ss.str() << "] out of " << state_count << ". Explanations follow in command line.");
-
-      // Call validity checks in verbose mode for the problematic states
-      visualization_msgs::MarkerArray arr;
-      for (std::size_t i = 0; i < index.size(); ++i)
-      {
-        /*
-        // check validity with verbose on
-        const robot_state::RobotState &robot_state = traj->getWayPoint(index[i]);
-        planning_scene_->isStateValid(robot_state, request.path_constraints, request.group_name, true);
-
-        // compute the contacts if any
-        collision_detection::CollisionRequest c_req;
-        collision_detection::CollisionResult c_res;
-        c_req.contacts = true;
-        c_req.max_contacts = 10;
-        c_req.max_contacts_per_pair = 3;
-        c_req.verbose = false;
-        planning_scene_->checkCollision(c_req, c_res, robot_state);
-        */
-        ROS_ERROR_STREAM_NAMED(name_, "checkMoveItPathSolution: TODO: show collision states in code " << i);
-        /*
-          if (c_res.contact_count > 0)
-          {
-          visualization_msgs::MarkerArray arr_i;
-          collision_detection::getCollisionMarkersFromContacts(arr_i, planning_scene_->getPlanningFrame(),
-          c_res.contacts);
-          arr.markers.insert(arr.markers.end(), arr_i.markers.begin(), arr_i.markers.end());
-          }
-        */
-      }
-      ROS_ERROR_STREAM_NAMED(name_, "checkMoveItPathSolution: Completed listing of explanations for invalid states.");
+      planning_scene_monitor::LockedPlanningSceneRO scene(planning_scene_monitor_);
+      snapshot = scene->diff();
+      snapshot->decoupleParent();
     }
+    path_validator_->setPlanningScene(snapshot);
   }
+
+  // Checked on worker threads while the next problem is set up and solved
+  path_validator_->checkPathAsync(path);
   return true;
 }
 
-bool CurieDemos::getRandomState(moveit::core::RobotStatePtr &robot_state)
+bool CurieDemos::waitForPathCheck()
+{
+  if (!path_validator_->hasPendingResult())
+    return true;
+
+  boost::shared_ptr<og::PathGeometric> path;
+  std::vector<std::size_t> index;
+  if (path_validator_->waitForResult(path, index))
+    return true;
+
+  const PathStreamerPtr &path_streamer = path_validator_->getPathStreamer();
+  return explainInvalidStates(index, path_streamer->getWayPointCount(*path),
+                              [&path, &path_streamer](std::size_t i, moveit::core::RobotState &robot_state)
+                              {
+                                path_streamer->getWayPoint(*path, i, robot_state);
+                              });
+}
+
+bool CurieDemos::explainInvalidStates(const std::vector<std::size_t> &index, std::size_t state_count,
+                                      const std::function<void(std::size_t, moveit::core::RobotState &)> &get_state)
 {
-  static const std::size_t MAX_ATTEMPTS = 1000;
-  for (std::size_t i = 0; i < MAX_ATTEMPTS; ++i)
+  if (index.size() == 1 && index[0] == 0)  // ignore cases when the robot starts at invalid location
   {
-    robot_state->setToRandomPositions(jmg_);
-    robot_state->update();
+    ROS_DEBUG("It appears the robot is starting at an invalid state, but that is ok.");
+    return true;
+  }
 
-    // Error check
-    bool check_verbose = false;
-    if (planning_scene_->isStateValid(*robot_state, "", check_verbose))  // second argument is what planning group to
-                                                                         // collision check, "" is everything
+  // display error messages
+  std::stringstream ss;
+  for (std::size_t i = 0; i < index.size(); ++i)
+    ss << index[i] << " ";
+  ROS_ERROR_STREAM_NAMED(name_, "Computed path is not valid. Invalid states at index locations: [ "
+                                    << ss.str() << "] out of " << state_count
+                                    << ". Explanations follow in command line.");
+
+  // Compute the contacts only for the problematic states
+  moveit::core::RobotState robot_state(*current_state_);
+  visualization_msgs::MarkerArray arr;
+  for (std::size_t i = 0; i < index.size(); ++i)
+  {
+    get_state(index[i], robot_state);
+    collision_detection::CollisionResult c_res;
+    path_validator_->getContacts(robot_state, c_res);
+
+    if (c_res.contact_count == 0)
     {
-      // ROS_DEBUG_STREAM_NAMED(name_, "Found valid random robot state after " << i << " attempts");
-      return true;
+      ROS_ERROR_STREAM_NAMED(name_, "State " << index[i] << " is infeasible but not in collision");
+      continue;
     }
 
-    if (i == 100)
-      ROS_WARN_STREAM_NAMED(name_, "Taking long time to find valid random state");
+    for (const auto &contact : c_res.contacts)
+      ROS_ERROR_STREAM_NAMED(name_, "State " << index[i] << " has contact between " << contact.first.first << " and "
+                                             << contact.first.second);
+
+    visualization_msgs::MarkerArray arr_i;
+    collision_detection::getCollisionMarkersFromContacts(arr_i, planning_scene_->getPlanningFrame(), c_res.contacts);
+    arr.markers.insert(arr.markers.end(), arr_i.markers.begin(), arr_i.markers.end());
+  }
+  ROS_ERROR_STREAM_NAMED(name_, "Completed listing of explanations for invalid states.");
+
+  if (!headless_ && !arr.markers.empty())
+  {
+    viz3_->getVisualTools()->publishMarkers(arr);
+    viz3_->trigger();
   }
 
-  ROS_ERROR_STREAM_NAMED(name_, "Unable to find valid random robot state");
-  exit(-1);
   return false;
 }
 
+bool CurieDemos::getRandomState(moveit::core::RobotStatePtr &robot_state)
+{
+  if (!random_state_sampler_->sample(*robot_state))
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "Unable to find valid random robot state");
+    random_state_sampler_->printStats();
+    return false;
+  }
+  return true;
+}
+
+void CurieDemos::saveDatabase()
+{
+  if (background_saver_)
+    background_saver_->requestSave();
+  else
+  {
+    TRACE_SCOPE("save_database");
+    experience_setup_->saveIfChanged();
+  }
+}
+
+void CurieDemos::saveTrace()
+{
+  if (!record_trace_)
+    return;
+
+  std::string file_path;
+  moveit_ompl::getFilePath(file_path, "curie_demos_trace.json", "ros/ompl_storage");
+  Tracer::save(file_path);
+}
+
+void CurieDemos::waitForDatabaseSave()
+{
+  if (background_saver_)
+    background_saver_->waitUntilIdle();
+}
+
 void CurieDemos::testMotionValidator()
 {
-  // THIS FUNCTION BROKEN BECAUSE moveit_core SAYS "FCL continuous collision checking not yet implemented"
+  if (!motion_validator_)
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "Continuous motion validation is disabled, nothing to test");
+    return;
+  }
 
-  // moveit::core::RobotStatePtr start = moveit::core::RobotStatePtr(new moveit::core::RobotState(*current_state_));
-  // moveit::core::RobotStatePtr goal = moveit::core::RobotStatePtr(new moveit::core::RobotState(*current_state_));
-  moveit_start_->setToRandomPositions(jmg_);
-  moveit_goal_->setToRandomPositions(jmg_);
+  // Compare against fixed resolution checking on random edges between valid states
+  ob::DiscreteMotionValidator discrete_validator(si_);
+  ob::State* start = si_->allocState();
+  ob::State* goal = si_->allocState();
+  const std::size_t num_edges = 1000;
+  std::size_t disagreements = 0;
+  std::size_t discrete_checks = 0;
+  const std::size_t conservative_checks = motion_validator_->getNumChecks();
+  double discrete_duration = 0;
+  double conservative_duration = 0;
+
+  for (std::size_t i = 0; i < num_edges; ++i)
+  {
+    if (!state_reservoir_->take(start) || !state_reservoir_->take(goal))
+    {
+      ROS_ERROR_STREAM_NAMED(name_, "Unable to get valid states for testing");
+      break;
+    }
 
-  // visual_moveit_start_->publishRobotState(moveit_start_, rvt::GREEN);
-  visual_moveit_goal_->publishRobotState(moveit_goal_, rvt::ORANGE);
+    ros::Time start_time = ros::Time::now();
+    const bool discrete_result = discrete_validator.checkMotion(start, goal);
+    discrete_duration += (ros::Time::now() - start_time).toSec();
+
+    start_time = ros::Time::now();
+    const bool conservative_result = motion_validator_->checkMotion(start, goal);
+    conservative_duration += (ros::Time::now() - start_time).toSec();
 
-  // Check for collision between to states
-  bool verbose = true;
-  collision_detection::CollisionResult res;
-  planning_scene_->checkCollision(validity_checker_->collision_request_with_distance_verbose_, res, *moveit_start_);
-  std::cout << "start state in collision: " << res.collision << std::endl;
+    // Discrete checking can step over thin obstacles, so only a conservative pass with a discrete failure is wrong
+    if (conservative_result && !discrete_result)
+      disagreements++;
 
-  collision_detection::CollisionRequest req;
-  req.group_name = planning_group_name_;
-  req.verbose = true;
+    // Same number of states the discrete validator interpolates
+    discrete_checks += si_->getStateSpace()->validSegmentCount(start, goal);
+  }
 
-  // Check motion
-  planning_scene_->getCollisionWorld()->checkCollision(req, res, *planning_scene_->getCollisionRobot(), *moveit_start_,
-                                                       *moveit_goal_);
+  ROS_INFO_STREAM_NAMED(name_, "Motion validator comparison over " << num_edges << " edges:");
+  ROS_INFO_STREAM_NAMED(name_, "  Discrete:     " << discrete_checks << " checks in " << discrete_duration << " s");
+  ROS_INFO_STREAM_NAMED(name_, "  Conservative: " << motion_validator_->getNumChecks() - conservative_checks
+                                                  << " checks in " << conservative_duration << " s");
+  if (disagreements)
+    ROS_ERROR_STREAM_NAMED(name_, "  Conservative validator accepted " << disagreements
+                                                                       << " edges the discrete validator rejected");
 
-  std::cout << "motion in collision: " << res.collision << std::endl;
+  si_->freeState(start);
+  si_->freeState(goal);
 }
 
 }  // namespace curie_demos
@@ -0,0 +1,118 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Contiguous storage for the joint solutions of every Cartesian point, released all at once
+*/
+
+// C++
+#include <algorithm>
+
+// this package
+#include <curie_demos/joint_pose_arena.h>
+#include <curie_demos/memory_usage.h>
+
+namespace curie_demos
+{
+JointPoseArena::JointPoseArena(std::size_t dim, std::size_t slab_poses) : dim_(dim), slab_poses_(slab_poses)
+{
+}
+
+JointPoseArena::~JointPoseArena()
+{
+  MemoryTracker::recordDeallocation(MEMORY_IK_BUFFERS, getCapacityBytes());
+}
+
+JointPoseLayer JointPoseArena::allocate(std::size_t num_poses)
+{
+  // Room for both layouts, next to each other
+  const std::size_t num_rows = 2 * num_poses;
+
+  // Find a slab with room for the whole layer, the leftover of skipped slabs is wasted until reset()
+  while (slab_id_ < slabs_.size() && slab_offset_ + num_rows > slabs_[slab_id_].capacity_)
+  {
+    slab_id_++;
+    slab_offset_ = 0;
+  }
+
+  // Grow
+  if (slab_id_ == slabs_.size())
+  {
+    Slab slab;
+    slab.capacity_ = std::max(slab_poses_, num_rows);
+    slab.data_.reset(new double[slab.capacity_ * dim_]);
+    MemoryTracker::recordAllocation(MEMORY_IK_BUFFERS, slab.capacity_ * dim_ * sizeof(double));
+    slabs_.push_back(std::move(slab));
+    slab_offset_ = 0;
+  }
+
+  JointPoseLayer layer;
+  layer.poses_ = slabs_[slab_id_].data_.get() + slab_offset_ * dim_;
+  layer.joints_ = layer.poses_ + num_poses * dim_;
+  layer.num_poses_ = num_poses;
+  layer.dim_ = dim_;
+
+  slab_offset_ += num_rows;
+  num_poses_ += num_poses;
+  return layer;
+}
+
+JointPoseLayer JointPoseArena::copy(const std::vector<std::vector<double>>& joint_poses)
+{
+  JointPoseLayer layer = allocate(joint_poses.size());
+  for (std::size_t i = 0; i < joint_poses.size(); ++i)
+  {
+    std::copy(joint_poses[i].begin(), joint_poses[i].begin() + dim_, layer.poses_ + i * dim_);
+    for (std::size_t j = 0; j < dim_; ++j)
+      layer.joints_[j * layer.num_poses_ + i] = joint_poses[i][j];
+  }
+  return layer;
+}
+
+void JointPoseArena::reset()
+{
+  slab_id_ = 0;
+  slab_offset_ = 0;
+  num_poses_ = 0;
+}
+
+std::size_t JointPoseArena::getCapacityBytes() const
+{
+  std::size_t bytes = 0;
+  for (const Slab& slab : slabs_)
+    bytes += slab.capacity_ * dim_ * sizeof(double);
+  return bytes;
+}
+
+}  // namespace curie_demos
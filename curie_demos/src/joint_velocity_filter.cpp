@@ -0,0 +1,135 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Joint velocity feasibility between neighboring Cartesian points, one pose against a whole layer
+*/
+
+// C++
+#include <cmath>
+#include <limits>
+
+// SIMD
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/joint_velocity_filter.h>
+
+namespace curie_demos
+{
+JointVelocityFilter::JointVelocityFilter(const moveit::core::JointModelGroup* jmg, double timing)
+{
+  const moveit::core::RobotModel& robot_model = jmg->getParentModel();
+  for (const std::string& variable : jmg->getVariableNames())
+  {
+    const moveit::core::VariableBounds& bounds = robot_model.getVariableBounds(variable);
+    if (bounds.velocity_bounded_)
+      max_motion_.push_back(timing * std::min(std::abs(bounds.min_velocity_), std::abs(bounds.max_velocity_)));
+    else
+    {
+      ROS_WARN_STREAM_NAMED(name_, "Joint " << variable << " has no velocity limit");
+      max_motion_.push_back(std::numeric_limits<double>::infinity());
+    }
+  }
+}
+
+bool JointVelocityFilter::isValidMove(const double* from_pose, const double* to_pose) const
+{
+  for (std::size_t j = 0; j < max_motion_.size(); ++j)
+    if (std::abs(from_pose[j] - to_pose[j]) > max_motion_[j])
+      return false;
+  return true;
+}
+
+std::size_t JointVelocityFilter::filterLayer(const JointPoseLayer& layer, const double* pose,
+                                             std::vector<uint64_t>& feasible) const
+{
+  const std::size_t num_poses = layer.num_poses_;
+  const std::size_t num_joints = max_motion_.size();
+  feasible.assign((num_poses + 63) / 64, 0);
+
+  // Each block of poses keeps its running mask in a register while reading one value from every joint array
+  std::size_t i = 0;
+#if defined(__AVX__)
+  const __m256d sign_mask = _mm256_set1_pd(-0.0);
+  for (; i + 4 <= num_poses; i += 4)
+  {
+    __m256d valid = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      const __m256d delta = _mm256_sub_pd(_mm256_loadu_pd(layer.getJoint(j) + i), _mm256_set1_pd(pose[j]));
+      const __m256d motion = _mm256_andnot_pd(sign_mask, delta);
+      valid = _mm256_and_pd(valid, _mm256_cmp_pd(motion, _mm256_set1_pd(max_motion_[j]), _CMP_LE_OQ));
+    }
+    feasible[i >> 6] |= static_cast<uint64_t>(_mm256_movemask_pd(valid)) << (i & 63);
+  }
+#elif defined(__SSE2__)
+  const __m128d sign_mask = _mm_set1_pd(-0.0);
+  for (; i + 2 <= num_poses; i += 2)
+  {
+    __m128d valid = _mm_castsi128_pd(_mm_set1_epi32(-1));
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      const __m128d delta = _mm_sub_pd(_mm_loadu_pd(layer.getJoint(j) + i), _mm_set1_pd(pose[j]));
+      const __m128d motion = _mm_andnot_pd(sign_mask, delta);
+      valid = _mm_and_pd(valid, _mm_cmple_pd(motion, _mm_set1_pd(max_motion_[j])));
+    }
+    feasible[i >> 6] |= static_cast<uint64_t>(_mm_movemask_pd(valid)) << (i & 63);
+  }
+#endif
+
+  // Remainder, or everything without SIMD
+  for (; i < num_poses; ++i)
+  {
+    bool valid = true;
+    for (std::size_t j = 0; j < num_joints && valid; ++j)
+      valid = std::abs(layer.getJoint(j)[i] - pose[j]) <= max_motion_[j];
+    if (valid)
+      feasible[i >> 6] |= uint64_t(1) << (i & 63);
+  }
+
+  std::size_t count = 0;
+  for (uint64_t word : feasible)
+    count += __builtin_popcountll(word);
+  return count;
+}
+
+}  // namespace curie_demos
@@ -0,0 +1,93 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Dynamic programming over the layers of a Cartesian path
+*/
+
+// C++
+#include <algorithm>
+#include <limits>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/layered_path_solver.h>
+
+namespace curie_demos
+{
+LayeredPathSolver::LayeredPathSolver() : shortest_cost_(std::numeric_limits<double>::infinity())
+{
+}
+
+bool LayeredPathSolver::solve(const std::vector<std::size_t>& layer_sizes, const TransitionCost& transition_cost)
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  shortest_cost_ = inf;
+  start_cost_.clear();
+  if (layer_sizes.empty())
+    return false;
+
+  // Cost to go of the last layer is zero, then sweep backwards
+  CostLayer cost(layer_sizes.back(), 0.0);
+  CostLayer next_cost;
+  for (std::size_t traj_id = layer_sizes.size() - 1; traj_id > 0; --traj_id)
+  {
+    const std::size_t layer_id = traj_id - 1;
+    next_cost.swap(cost);
+    cost.assign(layer_sizes[layer_id], inf);
+
+    for (std::size_t pose0 = 0; pose0 < layer_sizes[layer_id]; ++pose0)
+    {
+      for (std::size_t pose1 = 0; pose1 < layer_sizes[traj_id]; ++pose1)
+      {
+        // Dead ends need no edge cost
+        if (next_cost[pose1] == inf)
+          continue;
+
+        cost[pose0] = std::min(cost[pose0], transition_cost(traj_id, pose0, pose1) + next_cost[pose1]);
+      }
+    }
+  }
+
+  start_cost_.swap(cost);
+  for (double start_cost : start_cost_)
+    shortest_cost_ = std::min(shortest_cost_, start_cost);
+
+  ROS_DEBUG_STREAM_NAMED(name_, "Shortest cost across " << layer_sizes.size() << " layers: " << shortest_cost_);
+  return shortest_cost_ < inf;
+}
+
+}  // namespace curie_demos
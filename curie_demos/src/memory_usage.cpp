@@ -0,0 +1,224 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Cheap process memory readings and per subsystem allocation accounting
+*/
+
+// C++
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/memory_usage.h>
+
+namespace curie_demos
+{
+namespace
+{
+struct MemoryPhase
+{
+  std::string name_;
+  double rss_begin_ = 0.0;
+  double rss_end_ = 0.0;
+  std::size_t peak_bytes_[MEMORY_NUM_SUBSYSTEMS] = {};
+};
+
+std::atomic<std::size_t> current_bytes[MEMORY_NUM_SUBSYSTEMS];
+std::atomic<std::size_t> peak_bytes[MEMORY_NUM_SUBSYSTEMS];
+
+std::atomic<bool> enabled(false);
+
+// Protects the phases
+std::mutex phase_mutex;
+std::vector<MemoryPhase> phases;
+bool phase_in_progress = false;
+
+double getResidentSet()
+{
+  double vm, rss;
+  getMemoryUsage(vm, rss);
+  return rss;
+}
+
+/** \brief Peak RSS of the process, the VmHWM line of /proc/self/status, in MB */
+double getPeakResidentSet()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+  {
+    unsigned long kb;
+    if (std::sscanf(line.c_str(), "VmHWM: %lu kB", &kb) == 1)
+      return kb / 1024.0;
+  }
+  return 0.0;
+}
+}  // namespace
+
+bool getMemoryUsage(double& vm_usage, double& resident_set)
+{
+  static const double page_size_mb = sysconf(_SC_PAGE_SIZE) / 1048576.0;
+
+  vm_usage = 0.0;
+  resident_set = 0.0;
+
+  FILE* file = std::fopen("/proc/self/statm", "r");
+  if (!file)
+    return false;
+
+  unsigned long vm_pages, rss_pages;
+  const bool read = std::fscanf(file, "%lu %lu", &vm_pages, &rss_pages) == 2;
+  std::fclose(file);
+  if (!read)
+    return false;
+
+  vm_usage = vm_pages * page_size_mb;
+  resident_set = rss_pages * page_size_mb;
+  return true;
+}
+
+void MemoryTracker::recordAllocation(MemorySubsystem subsystem, std::size_t bytes)
+{
+  const std::size_t current = current_bytes[subsystem].fetch_add(bytes) + bytes;
+
+  std::size_t peak = peak_bytes[subsystem].load();
+  while (current > peak && !peak_bytes[subsystem].compare_exchange_weak(peak, current))
+  {
+  }
+}
+
+void MemoryTracker::recordDeallocation(MemorySubsystem subsystem, std::size_t bytes)
+{
+  current_bytes[subsystem].fetch_sub(bytes);
+}
+
+std::size_t MemoryTracker::getCurrentBytes(MemorySubsystem subsystem)
+{
+  return current_bytes[subsystem].load();
+}
+
+std::size_t MemoryTracker::getPeakBytes(MemorySubsystem subsystem)
+{
+  return peak_bytes[subsystem].load();
+}
+
+void MemoryTracker::setEnabled(bool enable)
+{
+  enabled = enable;
+}
+
+bool MemoryTracker::isEnabled()
+{
+  return enabled;
+}
+
+void MemoryTracker::beginPhase(const std::string& name)
+{
+  if (!enabled)
+    return;
+
+  endPhase();
+
+  std::lock_guard<std::mutex> lock(phase_mutex);
+  MemoryPhase phase;
+  phase.name_ = name;
+  phase.rss_begin_ = getResidentSet();
+  phases.push_back(phase);
+  phase_in_progress = true;
+
+  // Peaks are per phase
+  for (std::size_t i = 0; i < MEMORY_NUM_SUBSYSTEMS; ++i)
+    peak_bytes[i] = current_bytes[i].load();
+}
+
+void MemoryTracker::endPhase()
+{
+  std::lock_guard<std::mutex> lock(phase_mutex);
+  if (!phase_in_progress)
+    return;
+
+  MemoryPhase& phase = phases.back();
+  phase.rss_end_ = getResidentSet();
+  for (std::size_t i = 0; i < MEMORY_NUM_SUBSYSTEMS; ++i)
+    phase.peak_bytes_[i] = peak_bytes[i].load();
+  phase_in_progress = false;
+}
+
+void MemoryTracker::printSummary()
+{
+  if (!enabled)
+    return;
+
+  endPhase();
+
+  std::lock_guard<std::mutex> lock(phase_mutex);
+  std::stringstream ss;
+  ss << "Memory usage by phase (MB):" << std::endl;
+  for (const MemoryPhase& phase : phases)
+  {
+    ss << "  " << phase.name_ << ": RSS " << phase.rss_begin_ << " -> " << phase.rss_end_ << " ("
+       << (phase.rss_end_ - phase.rss_begin_ >= 0 ? "+" : "") << phase.rss_end_ - phase.rss_begin_ << "), peak";
+    for (std::size_t i = 0; i < MEMORY_NUM_SUBSYSTEMS; ++i)
+      ss << " " << getSubsystemName(static_cast<MemorySubsystem>(i)) << ": " << phase.peak_bytes_[i] / 1048576.0;
+    ss << std::endl;
+  }
+  ss << "  Process peak RSS: " << getPeakResidentSet();
+  ROS_INFO_STREAM_NAMED("memory_usage", ss.str());
+}
+
+const char* MemoryTracker::getSubsystemName(MemorySubsystem subsystem)
+{
+  switch (subsystem)
+  {
+    case MEMORY_SPARSE_SAMPLING:
+      return "sparse_sampling";
+    case MEMORY_TASK_GRAPH:
+      return "task_graph";
+    case MEMORY_IK_BUFFERS:
+      return "ik_buffers";
+    case MEMORY_ROADMAP_STATES:
+      return "roadmap_states";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace curie_demos
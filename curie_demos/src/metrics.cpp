@@ -0,0 +1,311 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Process wide counters, gauges and histograms updated lock free from the hot paths
+*/
+
+// C++
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/metrics.h>
+
+namespace curie_demos
+{
+namespace
+{
+enum MetricType
+{
+  METRIC_COUNTER,
+  METRIC_GAUGE,
+  METRIC_HISTOGRAM
+};
+
+struct MetricEntry
+{
+  std::string name_;
+  std::string help_;
+  MetricType type_;
+  std::unique_ptr<MetricCounter> counter_;
+  std::unique_ptr<MetricGauge> gauge_;
+  std::unique_ptr<MetricHistogram> histogram_;
+};
+
+// Protects the registry, only taken when registering and reading metrics
+std::mutex registry_mutex;
+// In order of registration
+std::vector<std::unique_ptr<MetricEntry>> entries;
+std::map<std::string, MetricEntry*> entries_by_name;
+// Metrics whose name and fallback name are both taken, updated by their callers but never written out
+std::vector<std::unique_ptr<MetricEntry>> unexported_entries;
+
+std::atomic<std::size_t> next_shard(0);
+
+/** \brief The entry of a name, created if needed, or nullptr when the name has another type */
+MetricEntry* getEntry(const std::string& name, const std::string& help, MetricType type)
+{
+  std::map<std::string, MetricEntry*>::iterator it = entries_by_name.find(name);
+  if (it != entries_by_name.end())
+  {
+    if (it->second->type_ != type)
+    {
+      ROS_ERROR_STREAM_NAMED("metrics", "Metric " << name << " is already registered with another type");
+      return nullptr;
+    }
+    return it->second;
+  }
+
+  entries.push_back(std::unique_ptr<MetricEntry>(new MetricEntry()));
+  MetricEntry* entry = entries.back().get();
+  entry->name_ = name;
+  entry->help_ = help;
+  entry->type_ = type;
+  entries_by_name[name] = entry;
+  return entry;
+}
+
+/** \brief The entry of a name, else of the name with a suffix for its type. If both are registered with another
+ *         type the entry is not exported, but lives as long as the process so the caller can still update it */
+MetricEntry* getEntryOrFallback(const std::string& name, const std::string& help, MetricType type,
+                                const std::string& suffix)
+{
+  MetricEntry* entry = getEntry(name, help, type);
+  if (!entry)
+    entry = getEntry(name + suffix, help, type);
+  if (entry)
+    return entry;
+
+  ROS_ERROR_STREAM_NAMED("metrics", "Metric names " << name << " and " << name + suffix
+                                                    << " are both registered with another type, " << name
+                                                    << " will not be exported");
+  unexported_entries.push_back(std::unique_ptr<MetricEntry>(new MetricEntry()));
+  entry = unexported_entries.back().get();
+  entry->name_ = name + suffix;
+  entry->help_ = help;
+  entry->type_ = type;
+  return entry;
+}
+
+void writeHeader(std::ostream& out, const MetricEntry& entry, const char* type)
+{
+  out << "# HELP " << entry.name_ << " " << entry.help_ << "\n";
+  out << "# TYPE " << entry.name_ << " " << type << "\n";
+}
+}  // namespace
+
+std::uint64_t MetricCounter::getValue() const
+{
+  std::uint64_t value = 0;
+  for (const Shard& shard : shards_)
+    value += shard.value_.load(std::memory_order_relaxed);
+  return value;
+}
+
+std::size_t MetricCounter::getShardIndex()
+{
+  thread_local const std::size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+  return shard;
+}
+
+MetricHistogram::MetricHistogram(const std::vector<double>& bounds)
+  : bounds_(bounds), counts_(new std::atomic<std::uint64_t>[bounds.size() + 1])
+{
+  for (std::size_t i = 0; i <= bounds_.size(); ++i)
+    counts_[i].store(0, std::memory_order_relaxed);
+}
+
+void MetricHistogram::observe(double value)
+{
+  std::size_t bucket = 0;
+  while (bucket < bounds_.size() && value > bounds_[bucket])
+    bucket++;
+  counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  double sum = sum_.load(std::memory_order_relaxed);
+  while (!sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+  {
+  }
+}
+
+std::vector<std::uint64_t> MetricHistogram::getBucketCounts() const
+{
+  std::vector<std::uint64_t> counts(bounds_.size() + 1);
+  for (std::size_t i = 0; i < counts.size(); ++i)
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+  return counts;
+}
+
+MetricCounter& Metrics::getCounter(const std::string& name, const std::string& help)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  MetricEntry* entry = getEntryOrFallback(name, help, METRIC_COUNTER, "_counter");
+  if (!entry->counter_)
+    entry->counter_.reset(new MetricCounter());
+  return *entry->counter_;
+}
+
+MetricGauge& Metrics::getGauge(const std::string& name, const std::string& help)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  MetricEntry* entry = getEntryOrFallback(name, help, METRIC_GAUGE, "_gauge");
+  if (!entry->gauge_)
+    entry->gauge_.reset(new MetricGauge());
+  return *entry->gauge_;
+}
+
+MetricHistogram& Metrics::getHistogram(const std::string& name, const std::string& help,
+                                       const std::vector<double>& bounds)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  MetricEntry* entry = getEntryOrFallback(name, help, METRIC_HISTOGRAM, "_histogram");
+  if (!entry->histogram_)
+    entry->histogram_.reset(new MetricHistogram(bounds));
+  return *entry->histogram_;
+}
+
+const std::vector<double>& Metrics::getSecondsBounds()
+{
+  static const std::vector<double> bounds = { 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25,
+                                              0.5,   1.0,    2.5,   5.0,  10.0,  25.0, 50.0, 100.0 };
+  return bounds;
+}
+
+MetricCounter& Metrics::getValidityChecksCounter()
+{
+  static MetricCounter& checks = getCounter("curie_demos_validity_checks_total", "States checked for validity");
+  return checks;
+}
+
+MetricCounter& Metrics::getValidityCollisionsCounter()
+{
+  static MetricCounter& collisions =
+      getCounter("curie_demos_validity_collisions_total", "Checked states found in collision");
+  return collisions;
+}
+
+void Metrics::getValues(std::vector<std::pair<std::string, double>>& values)
+{
+  values.clear();
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (const std::unique_ptr<MetricEntry>& entry : entries)
+  {
+    switch (entry->type_)
+    {
+      case METRIC_COUNTER:
+        values.push_back(std::make_pair(entry->name_, entry->counter_->getValue()));
+        break;
+      case METRIC_GAUGE:
+        values.push_back(std::make_pair(entry->name_, entry->gauge_->getValue()));
+        break;
+      case METRIC_HISTOGRAM:
+      {
+        std::uint64_t count = 0;
+        for (std::uint64_t bucket_count : entry->histogram_->getBucketCounts())
+          count += bucket_count;
+        const double sum = entry->histogram_->getSum();
+        values.push_back(std::make_pair(entry->name_ + "_count", count));
+        values.push_back(std::make_pair(entry->name_ + "_sum", sum));
+        values.push_back(std::make_pair(entry->name_ + "_mean", count ? sum / count : 0.0));
+        break;
+      }
+    }
+  }
+}
+
+void Metrics::writePrometheus(std::ostream& out)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (const std::unique_ptr<MetricEntry>& entry : entries)
+  {
+    switch (entry->type_)
+    {
+      case METRIC_COUNTER:
+        writeHeader(out, *entry, "counter");
+        out << entry->name_ << " " << entry->counter_->getValue() << "\n";
+        break;
+      case METRIC_GAUGE:
+        writeHeader(out, *entry, "gauge");
+        out << entry->name_ << " " << entry->gauge_->getValue() << "\n";
+        break;
+      case METRIC_HISTOGRAM:
+      {
+        // Prometheus buckets are cumulative
+        writeHeader(out, *entry, "histogram");
+        const std::vector<double>& bounds = entry->histogram_->getBounds();
+        const std::vector<std::uint64_t> counts = entry->histogram_->getBucketCounts();
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < bounds.size(); ++i)
+        {
+          cumulative += counts[i];
+          out << entry->name_ << "_bucket{le=\"" << bounds[i] << "\"} " << cumulative << "\n";
+        }
+        cumulative += counts.back();
+        out << entry->name_ << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+        out << entry->name_ << "_sum " << entry->histogram_->getSum() << "\n";
+        out << entry->name_ << "_count " << cumulative << "\n";
+        break;
+      }
+    }
+  }
+}
+
+bool Metrics::savePrometheus(const std::string& file_path)
+{
+  const std::string temp_path = file_path + ".tmp";
+  {
+    std::ofstream out(temp_path.c_str());
+    if (!out)
+    {
+      ROS_ERROR_STREAM_NAMED("metrics", "Unable to write metrics to " << temp_path);
+      return false;
+    }
+    writePrometheus(out);
+  }
+
+  if (std::rename(temp_path.c_str(), file_path.c_str()) != 0)
+  {
+    ROS_ERROR_STREAM_NAMED("metrics", "Unable to replace " << file_path);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace curie_demos
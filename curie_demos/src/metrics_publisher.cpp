@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Periodically publish the metrics registry as diagnostics and write it for Prometheus
+*/
+
+// C++
+#include <sstream>
+
+// ROS
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+// this package
+#include <curie_demos/memory_usage.h>
+#include <curie_demos/metrics.h>
+#include <curie_demos/metrics_publisher.h>
+
+namespace curie_demos
+{
+MetricsPublisher::MetricsPublisher(ros::NodeHandle nh, double period, const std::string& file_path)
+  : file_path_(file_path), previous_time_(ros::WallTime::now())
+{
+  publisher_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("metrics", 1);
+  timer_ = nh.createWallTimer(ros::WallDuration(period), &MetricsPublisher::timerCallback, this);
+
+  ROS_INFO_STREAM_NAMED(name_, "Publishing metrics on " << publisher_.getTopic() << " every " << period << "s"
+                                                        << (file_path_.empty() ? "" : " and writing to ")
+                                                        << file_path_);
+}
+
+void MetricsPublisher::update()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Memory is sampled here rather than on the hot paths
+  static MetricGauge& rss = Metrics::getGauge("curie_demos_resident_memory_mb", "Resident set size of the process");
+  static MetricGauge& vm = Metrics::getGauge("curie_demos_virtual_memory_mb", "Virtual memory size of the process");
+  double vm_usage, resident_set;
+  getMemoryUsage(vm_usage, resident_set);
+  rss.set(resident_set);
+  vm.set(vm_usage);
+  for (std::size_t i = 0; i < MEMORY_NUM_SUBSYSTEMS; ++i)
+  {
+    const MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+    Metrics::getGauge(std::string("curie_demos_") + MemoryTracker::getSubsystemName(subsystem) + "_bytes",
+                      "Bytes currently allocated by this subsystem")
+        .set(MemoryTracker::getCurrentBytes(subsystem));
+  }
+
+  std::vector<std::pair<std::string, double>> values;
+  Metrics::getValues(values);
+
+  const ros::WallTime now = ros::WallTime::now();
+  const double elapsed = (now - previous_time_).toSec();
+  previous_time_ = now;
+
+  diagnostic_msgs::DiagnosticArray msg;
+  msg.header.stamp = ros::Time::now();
+  msg.status.resize(1);
+  diagnostic_msgs::DiagnosticStatus& status = msg.status.front();
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "curie_demos: metrics";
+  status.hardware_id = ros::this_node::getName();
+  for (const std::pair<std::string, double>& value : values)
+  {
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = value.first;
+    std::ostringstream text;
+    text << value.second;
+    key_value.value = text.str();
+    status.values.push_back(key_value);
+
+    // Counters end in _total by convention
+    const std::string suffix = "_total";
+    if (value.first.size() > suffix.size() &&
+        value.first.compare(value.first.size() - suffix.size(), suffix.size(), suffix) == 0 && elapsed > 0.0)
+    {
+      const std::map<std::string, double>::const_iterator previous = previous_values_.find(value.first);
+      std::ostringstream rate;
+      rate << (value.second - (previous == previous_values_.end() ? 0.0 : previous->second)) / elapsed;
+      key_value.key = value.first.substr(0, value.first.size() - suffix.size()) + "_per_second";
+      key_value.value = rate.str();
+      status.values.push_back(key_value);
+      previous_values_[value.first] = value.second;
+    }
+  }
+  publisher_.publish(msg);
+
+  if (!file_path_.empty())
+    Metrics::savePrometheus(file_path_);
+}
+
+void MetricsPublisher::timerCallback(const ros::WallTimerEvent& event)
+{
+  update();
+}
+
+}  // namespace curie_demos
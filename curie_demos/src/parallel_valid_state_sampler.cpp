@@ -0,0 +1,69 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Valid state sampler that draws and collision checks candidate states on multiple threads
+*/
+
+// this package
+#include <curie_demos/parallel_valid_state_sampler.h>
+
+namespace curie_demos
+{
+ParallelValidStateSampler::ParallelValidStateSampler(const ompl::base::SpaceInformation *si,
+                                                     StateReservoirPtr reservoir)
+  : ompl::base::ValidStateSampler(si), reservoir_(reservoir)
+{
+  name_ = "parallel_valid_state_sampler";
+  near_sampler_ = si_->allocStateSampler();
+}
+
+bool ParallelValidStateSampler::sample(ompl::base::State *state)
+{
+  return reservoir_->take(state);
+}
+
+bool ParallelValidStateSampler::sampleNear(ompl::base::State *state, const ompl::base::State *near,
+                                           const double distance)
+{
+  for (unsigned int attempt = 0; attempt < attempts_; ++attempt)
+  {
+    near_sampler_->sampleUniformNear(state, near, distance);
+    if (si_->isValid(state))
+      return true;
+  }
+  return false;
+}
+
+}  // namespace curie_demos
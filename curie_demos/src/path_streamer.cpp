@@ -0,0 +1,135 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Walks a geometric path one waypoint at a time through a single reusable robot state
+*/
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+// this package
+#include <curie_demos/path_streamer.h>
+
+namespace curie_demos
+{
+PathStreamer::PathStreamer(moveit_ompl::ModelBasedStateSpacePtr space, double max_step)
+  : space_(space), max_step_(max_step)
+{
+}
+
+std::size_t PathStreamer::getWayPointCount(const ompl::geometric::PathGeometric &path) const
+{
+  if (path.getStateCount() == 0)
+    return 0;
+
+  std::size_t count = 1;
+  for (std::size_t i = 1; i < path.getStateCount(); ++i)
+    count += getSegmentCount(path.getState(i - 1), path.getState(i));
+  return count;
+}
+
+bool PathStreamer::stream(const ompl::geometric::PathGeometric &path, moveit::core::RobotState &robot_state,
+                          const WayPointCallback &callback, std::size_t begin, std::size_t end) const
+{
+  if (path.getStateCount() == 0 || begin >= end)
+    return true;
+
+  // Interpolated states are built here, the only allocation regardless of path length
+  ompl::base::State *state = space_->allocState();
+  bool result = true;
+
+  std::size_t index = 0;
+  if (begin == 0)
+  {
+    space_->copyToRobotState(robot_state, path.getState(0));
+    result = callback(index, robot_state);
+  }
+  index++;
+
+  for (std::size_t i = 1; i < path.getStateCount() && index < end && result; ++i)
+  {
+    const ompl::base::State *s1 = path.getState(i - 1);
+    const ompl::base::State *s2 = path.getState(i);
+    const std::size_t segment_count = getSegmentCount(s1, s2);
+
+    // Skip whole segments before the range
+    if (index + segment_count <= begin)
+    {
+      index += segment_count;
+      continue;
+    }
+
+    for (std::size_t j = 1; j <= segment_count && index < end && result; ++j, ++index)
+    {
+      if (index < begin)
+        continue;
+
+      if (j == segment_count)
+        space_->copyToRobotState(robot_state, s2);
+      else
+      {
+        space_->interpolate(s1, s2, static_cast<double>(j) / segment_count, state);
+        space_->copyToRobotState(robot_state, state);
+      }
+      result = callback(index, robot_state);
+    }
+  }
+
+  space_->freeState(state);
+  return result;
+}
+
+bool PathStreamer::getWayPoint(const ompl::geometric::PathGeometric &path, std::size_t index,
+                               moveit::core::RobotState &robot_state) const
+{
+  bool found = false;
+  stream(path, robot_state, [&found](std::size_t, const moveit::core::RobotState &)
+         {
+           found = true;
+           return false;
+         },
+         index, index + 1);
+  return found;
+}
+
+std::size_t PathStreamer::getSegmentCount(const ompl::base::State *s1, const ompl::base::State *s2) const
+{
+  if (max_step_ <= 0.0)
+    return 1;
+  return std::max(1.0, std::ceil(space_->distance(s1, s2) / max_step_));
+}
+
+}  // namespace curie_demos
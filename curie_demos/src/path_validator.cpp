@@ -0,0 +1,190 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Checks the waypoints of a solution trajectory in parallel, optionally while planning continues
+*/
+
+// C++
+#include <algorithm>
+#include <thread>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/path_validator.h>
+#include <curie_demos/metrics.h>
+#include <curie_demos/trace.h>
+
+namespace curie_demos
+{
+PathValidator::PathValidator(planning_scene::PlanningSceneConstPtr planning_scene, PathStreamerPtr path_streamer,
+                             std::size_t num_threads)
+  : planning_scene_(planning_scene), path_streamer_(path_streamer), num_threads_(num_threads)
+{
+  if (num_threads_ == 0)
+    num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+PathValidator::~PathValidator()
+{
+  if (pending_.valid())
+    pending_.wait();
+}
+
+bool PathValidator::checkPath(const ompl::geometric::PathGeometric &path, std::vector<std::size_t> &invalid_index) const
+{
+  return checkInChunks(path_streamer_->getWayPointCount(path),
+                       [this, &path](std::size_t begin, std::size_t end, std::vector<std::size_t> &chunk_invalid_index)
+                       {
+                         checkPathRange(path, begin, end, chunk_invalid_index);
+                       },
+                       invalid_index);
+}
+
+bool PathValidator::checkInChunks(
+    std::size_t num_waypoints,
+    const std::function<void(std::size_t, std::size_t, std::vector<std::size_t> &)> &check_range,
+    std::vector<std::size_t> &invalid_index) const
+{
+  TRACE_SCOPE("check_path");
+  invalid_index.clear();
+  if (num_waypoints == 0)
+    return true;
+
+  // Contiguous chunks keep each thread's waypoints together in memory
+  const std::size_t num_chunks = std::min(num_threads_, num_waypoints);
+  const std::size_t chunk_size = (num_waypoints + num_chunks - 1) / num_chunks;
+  std::vector<std::vector<std::size_t>> chunk_invalid_index(num_chunks);
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < num_chunks; ++i)
+    threads.push_back(std::thread(check_range, i * chunk_size, std::min(num_waypoints, (i + 1) * chunk_size),
+                                  std::ref(chunk_invalid_index[i])));
+
+  // This thread does the first chunk
+  check_range(0, std::min(num_waypoints, chunk_size), chunk_invalid_index[0]);
+
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // Chunks are in order so the result is sorted
+  for (const std::vector<std::size_t> &chunk : chunk_invalid_index)
+    invalid_index.insert(invalid_index.end(), chunk.begin(), chunk.end());
+
+  return invalid_index.empty();
+}
+
+void PathValidator::setPlanningScene(planning_scene::PlanningSceneConstPtr planning_scene)
+{
+  if (pending_.valid())
+    pending_.wait();
+
+  planning_scene_ = planning_scene;
+}
+
+void PathValidator::checkPathAsync(const ompl::geometric::PathGeometric &path)
+{
+  if (pending_.valid())
+    pending_.wait();
+
+  // The caller's path may be cleared by the next solve
+  boost::shared_ptr<ompl::geometric::PathGeometric> path_copy(new ompl::geometric::PathGeometric(path));
+  pending_path_ = path_copy;
+  pending_ = std::async(std::launch::async, [this, path_copy]()
+                        {
+                          std::vector<std::size_t> invalid_index;
+                          checkPath(*path_copy, invalid_index);
+                          return invalid_index;
+                        });
+}
+
+bool PathValidator::waitForResult(boost::shared_ptr<ompl::geometric::PathGeometric> &path,
+                                  std::vector<std::size_t> &invalid_index)
+{
+  if (!pending_.valid())
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "No path check in progress");
+    return false;
+  }
+
+  static MetricCounter &checks = Metrics::getCounter("curie_demos_path_checks_total", "Solution paths checked");
+  static MetricCounter &invalid =
+      Metrics::getCounter("curie_demos_path_checks_invalid_total", "Solution paths with invalid states");
+
+  invalid_index = pending_.get();
+  path = pending_path_;
+  pending_path_.reset();
+
+  checks.increment();
+  if (!invalid_index.empty())
+    invalid.increment();
+
+  return invalid_index.empty();
+}
+
+void PathValidator::getContacts(const moveit::core::RobotState &state, collision_detection::CollisionResult &res) const
+{
+  collision_detection::CollisionRequest req;
+  req.contacts = true;
+  req.max_contacts = 10;
+  req.max_contacts_per_pair = 3;
+  req.verbose = false;
+
+  moveit::core::RobotState local_state(state);
+  local_state.update();
+  planning_scene_->checkCollision(req, res, local_state);
+}
+
+void PathValidator::checkPathRange(const ompl::geometric::PathGeometric &path, std::size_t begin, std::size_t end,
+                                   std::vector<std::size_t> &invalid_index) const
+{
+  TRACE_SCOPE("check_path_chunk");
+
+  // The only state this thread needs, whatever the length of the path
+  moveit::core::RobotState local_state(planning_scene_->getCurrentState());
+
+  path_streamer_->stream(path, local_state, [this, &local_state, &invalid_index](std::size_t index,
+                                                                                 const moveit::core::RobotState &)
+                         {
+                           local_state.update();
+                           if (!planning_scene_->isStateValid(local_state))
+                             invalid_index.push_back(index);
+                           return true;
+                         },
+                         begin, end);
+}
+
+}  // namespace curie_demos
@@ -0,0 +1,360 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Joint values of every roadmap vertex in contiguous slabs, optionally quantized
+*/
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/roadmap_state_store.h>
+#include <curie_demos/memory_usage.h>
+
+namespace curie_demos
+{
+namespace
+{
+const double FIXED16_STEPS = 65535.0;
+
+// Round to nearest of a float, relative to the value
+const double FLOAT_RELATIVE_ERROR = std::ldexp(1.0, -24);
+}  // namespace
+
+RoadmapStateStore::RoadmapStateStore(const std::vector<double>& lower_bounds, const std::vector<double>& upper_bounds,
+                                     StateStorageType type, std::size_t slab_states)
+  : dim_(lower_bounds.size())
+  , type_(type)
+  , slab_states_(std::max<std::size_t>(slab_states, 1))
+  , lower_bounds_(lower_bounds)
+  , upper_bounds_(upper_bounds)
+  , scale_(dim_, 0.0)
+  , max_abs_values_(dim_, 0.0)
+  , max_clamp_errors_(dim_, 0.0)
+{
+  if (type_ == STORAGE_FIXED16)
+  {
+    for (std::size_t j = 0; j < dim_; ++j)
+    {
+      if (!std::isfinite(lower_bounds_[j]) || !std::isfinite(upper_bounds_[j]))
+      {
+        ROS_WARN_STREAM_NAMED("roadmap_state_store", "Joint " << j << " is unbounded, unable to use fixed point "
+                                                                         "storage - using float instead");
+        type_ = STORAGE_FLOAT;
+        break;
+      }
+      scale_[j] = (upper_bounds_[j] - lower_bounds_[j]) / FIXED16_STEPS;
+    }
+  }
+
+  switch (type_)
+  {
+    case STORAGE_DOUBLE:
+      state_bytes_ = dim_ * sizeof(double);
+      break;
+    case STORAGE_FLOAT:
+      state_bytes_ = dim_ * sizeof(float);
+      break;
+    case STORAGE_FIXED16:
+      state_bytes_ = dim_ * sizeof(uint16_t);
+      break;
+  }
+
+  updateDistanceErrorBound();
+}
+
+RoadmapStateStore::~RoadmapStateStore()
+{
+  MemoryTracker::recordDeallocation(MEMORY_ROADMAP_STATES, getCapacityBytes());
+}
+
+std::size_t RoadmapStateStore::addState(const double* values)
+{
+  // Grow
+  if (num_states_ == slabs_.size() * slab_states_)
+  {
+    slabs_.emplace_back(new unsigned char[slab_states_ * state_bytes_]);
+    MemoryTracker::recordAllocation(MEMORY_ROADMAP_STATES, slab_states_ * state_bytes_);
+  }
+
+  trackErrors(values);
+  encode(values, slabs_[num_states_ / slab_states_].get() + (num_states_ % slab_states_) * state_bytes_);
+  return num_states_++;
+}
+
+void RoadmapStateStore::trackErrors(const double* values)
+{
+  bool widened = false;
+  switch (type_)
+  {
+    case STORAGE_DOUBLE:
+      break;
+    case STORAGE_FLOAT:
+      for (std::size_t j = 0; j < dim_; ++j)
+      {
+        const double abs_value = std::abs(values[j]);
+        if (abs_value > max_abs_values_[j])
+        {
+          max_abs_values_[j] = abs_value;
+          widened = true;
+        }
+      }
+      break;
+    case STORAGE_FIXED16:
+      for (std::size_t j = 0; j < dim_; ++j)
+      {
+        const double clamp_error = std::max(lower_bounds_[j] - values[j], values[j] - upper_bounds_[j]);
+        if (clamp_error <= 0.0)
+          continue;
+
+        if (num_clamped_ == 0)
+          ROS_WARN_STREAM_NAMED("roadmap_state_store", "Joint " << j << " value " << values[j]
+                                                                << " is outside of its bounds, clamping. The "
+                                                                   "distance error bound is widened to match");
+        num_clamped_++;
+        if (clamp_error > max_clamp_errors_[j])
+        {
+          max_clamp_errors_[j] = clamp_error;
+          widened = true;
+        }
+      }
+      break;
+  }
+
+  if (widened)
+    updateDistanceErrorBound();
+}
+
+void RoadmapStateStore::updateDistanceErrorBound()
+{
+  // Each stored state moves by at most the norm of the per joint errors, so the distance between two stored
+  // states differs from the original distance by at most twice that (triangle inequality)
+  double squared_error = 0.0;
+  for (std::size_t j = 0; j < dim_; ++j)
+    squared_error += getQuantizationError(j) * getQuantizationError(j);
+  distance_error_bound_ = 2.0 * std::sqrt(squared_error);
+}
+
+void RoadmapStateStore::encode(const double* values, unsigned char* data) const
+{
+  switch (type_)
+  {
+    case STORAGE_DOUBLE:
+      std::copy(values, values + dim_, reinterpret_cast<double*>(data));
+      break;
+    case STORAGE_FLOAT:
+    {
+      float* stored = reinterpret_cast<float*>(data);
+      for (std::size_t j = 0; j < dim_; ++j)
+        stored[j] = static_cast<float>(values[j]);
+      break;
+    }
+    case STORAGE_FIXED16:
+    {
+      uint16_t* stored = reinterpret_cast<uint16_t*>(data);
+      for (std::size_t j = 0; j < dim_; ++j)
+      {
+        const double steps = scale_[j] > 0.0 ? (values[j] - lower_bounds_[j]) / scale_[j] : 0.0;
+        stored[j] = static_cast<uint16_t>(std::min(std::max(std::round(steps), 0.0), FIXED16_STEPS));
+      }
+      break;
+    }
+  }
+}
+
+void RoadmapStateStore::getState(std::size_t index, double* values) const
+{
+  const unsigned char* data = getStateData(index);
+  switch (type_)
+  {
+    case STORAGE_DOUBLE:
+    {
+      const double* stored = reinterpret_cast<const double*>(data);
+      std::copy(stored, stored + dim_, values);
+      break;
+    }
+    case STORAGE_FLOAT:
+    {
+      const float* stored = reinterpret_cast<const float*>(data);
+      std::copy(stored, stored + dim_, values);
+      break;
+    }
+    case STORAGE_FIXED16:
+    {
+      const uint16_t* stored = reinterpret_cast<const uint16_t*>(data);
+      for (std::size_t j = 0; j < dim_; ++j)
+        values[j] = lower_bounds_[j] + stored[j] * scale_[j];
+      break;
+    }
+  }
+}
+
+double RoadmapStateStore::getValue(std::size_t index, std::size_t joint) const
+{
+  const unsigned char* data = getStateData(index);
+  switch (type_)
+  {
+    case STORAGE_DOUBLE:
+      return reinterpret_cast<const double*>(data)[joint];
+    case STORAGE_FLOAT:
+      return reinterpret_cast<const float*>(data)[joint];
+    case STORAGE_FIXED16:
+      return lower_bounds_[joint] + reinterpret_cast<const uint16_t*>(data)[joint] * scale_[joint];
+  }
+  return 0.0;
+}
+
+double RoadmapStateStore::distance(std::size_t index1, std::size_t index2) const
+{
+  const unsigned char* data1 = getStateData(index1);
+  const unsigned char* data2 = getStateData(index2);
+  double squared = 0.0;
+  switch (type_)
+  {
+    case STORAGE_DOUBLE:
+    {
+      const double* stored1 = reinterpret_cast<const double*>(data1);
+      const double* stored2 = reinterpret_cast<const double*>(data2);
+      for (std::size_t j = 0; j < dim_; ++j)
+        squared += (stored1[j] - stored2[j]) * (stored1[j] - stored2[j]);
+      break;
+    }
+    case STORAGE_FLOAT:
+    {
+      const float* stored1 = reinterpret_cast<const float*>(data1);
+      const float* stored2 = reinterpret_cast<const float*>(data2);
+      for (std::size_t j = 0; j < dim_; ++j)
+      {
+        const double diff = static_cast<double>(stored1[j]) - stored2[j];
+        squared += diff * diff;
+      }
+      break;
+    }
+    case STORAGE_FIXED16:
+    {
+      // Same bounds for both states, so only the steps differ
+      const uint16_t* stored1 = reinterpret_cast<const uint16_t*>(data1);
+      const uint16_t* stored2 = reinterpret_cast<const uint16_t*>(data2);
+      for (std::size_t j = 0; j < dim_; ++j)
+      {
+        const double diff = (static_cast<int>(stored1[j]) - static_cast<int>(stored2[j])) * scale_[j];
+        squared += diff * diff;
+      }
+      break;
+    }
+  }
+  return std::sqrt(squared);
+}
+
+double RoadmapStateStore::distance(std::size_t index, const double* values) const
+{
+  // Decode inside one loop per type, this is the inner loop of nearest neighbor scans
+  const unsigned char* data = getStateData(index);
+  double squared = 0.0;
+  switch (type_)
+  {
+    case STORAGE_DOUBLE:
+    {
+      const double* stored = reinterpret_cast<const double*>(data);
+      for (std::size_t j = 0; j < dim_; ++j)
+        squared += (stored[j] - values[j]) * (stored[j] - values[j]);
+      break;
+    }
+    case STORAGE_FLOAT:
+    {
+      const float* stored = reinterpret_cast<const float*>(data);
+      for (std::size_t j = 0; j < dim_; ++j)
+      {
+        const double diff = stored[j] - values[j];
+        squared += diff * diff;
+      }
+      break;
+    }
+    case STORAGE_FIXED16:
+    {
+      const uint16_t* stored = reinterpret_cast<const uint16_t*>(data);
+      for (std::size_t j = 0; j < dim_; ++j)
+      {
+        const double diff = lower_bounds_[j] + stored[j] * scale_[j] - values[j];
+        squared += diff * diff;
+      }
+      break;
+    }
+  }
+  return std::sqrt(squared);
+}
+
+void RoadmapStateStore::getDistanceBounds(std::size_t index1, std::size_t index2, double& lower, double& upper) const
+{
+  const double stored_distance = distance(index1, index2);
+  lower = std::max(0.0, stored_distance - distance_error_bound_);
+  upper = stored_distance + distance_error_bound_;
+}
+
+double RoadmapStateStore::getQuantizationError(std::size_t joint) const
+{
+  switch (type_)
+  {
+    case STORAGE_DOUBLE:
+      return 0.0;
+    case STORAGE_FLOAT:
+      return FLOAT_RELATIVE_ERROR * max_abs_values_[joint];
+    case STORAGE_FIXED16:
+      // A clamped value lands on a bound exactly, moving by its distance outside
+      return std::max(scale_[joint] / 2.0, max_clamp_errors_[joint]);
+  }
+  return 0.0;
+}
+
+void RoadmapStateStore::clear()
+{
+  num_states_ = 0;
+  num_clamped_ = 0;
+  std::fill(max_abs_values_.begin(), max_abs_values_.end(), 0.0);
+  std::fill(max_clamp_errors_.begin(), max_clamp_errors_.end(), 0.0);
+  updateDistanceErrorBound();
+}
+
+std::size_t RoadmapStateStore::getCapacityBytes() const
+{
+  return slabs_.size() * slab_states_ * state_bytes_;
+}
+
+}  // namespace curie_demos
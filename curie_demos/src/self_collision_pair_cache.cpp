@@ -0,0 +1,298 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Self collision pairs of a planning group that are always or never in collision, found by sampling
+*/
+
+// C++
+#include <cstring>
+#include <fstream>
+#include <map>
+
+// ROS
+#include <ros/ros.h>
+
+// Random
+#include <random_numbers/random_numbers.h>
+
+// this package
+#include <curie_demos/self_collision_pair_cache.h>
+#include <curie_demos/collision_pair_filter.h>
+
+namespace curie_demos
+{
+namespace
+{
+const boost::uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const boost::uint64_t FNV_PRIME = 1099511628211ULL;
+
+/** \brief FNV-1a, stable across runs and builds unlike std::hash, so it can be saved to file */
+void hashCombine(boost::uint64_t& hash, const std::string& value)
+{
+  for (unsigned char c : value)
+  {
+    hash ^= c;
+    hash *= FNV_PRIME;
+  }
+  // Separate consecutive strings
+  hash ^= 0xff;
+  hash *= FNV_PRIME;
+}
+
+/** \brief Hash the exact bits of a value, any change of a joint position can change which pairs collide */
+void hashCombine(boost::uint64_t& hash, double value)
+{
+  unsigned char bytes[sizeof(double)];
+  std::memcpy(bytes, &value, sizeof(double));
+  for (unsigned char byte : bytes)
+  {
+    hash ^= byte;
+    hash *= FNV_PRIME;
+  }
+}
+
+/** \brief Hash of every pair of links with collision geometry that acm allows always or conditionally */
+boost::uint64_t hashAllowedCollisions(const moveit::core::RobotModel& robot_model,
+                                      const collision_detection::AllowedCollisionMatrix& acm)
+{
+  boost::uint64_t hash = FNV_OFFSET;
+  const std::vector<const moveit::core::LinkModel*>& links = robot_model.getLinkModelsWithCollisionGeometry();
+  for (std::size_t i = 0; i < links.size(); ++i)
+    for (std::size_t j = i + 1; j < links.size(); ++j)
+    {
+      collision_detection::AllowedCollision::Type type;
+      if (!acm.getEntry(links[i]->getName(), links[j]->getName(), type) ||
+          type == collision_detection::AllowedCollision::NEVER)
+        continue;
+      hashCombine(hash, links[i]->getName());
+      hashCombine(hash, links[j]->getName());
+      hashCombine(hash, type == collision_detection::AllowedCollision::ALWAYS ? "always" : "conditional");
+    }
+  return hash;
+}
+
+/** \brief Hash of the values of every joint outside the group, which stay at the reference state while sampling */
+boost::uint64_t hashReferenceValues(const moveit::core::JointModelGroup& jmg,
+                                    const moveit::core::RobotState& reference_state)
+{
+  boost::uint64_t hash = FNV_OFFSET;
+  for (const moveit::core::JointModel* joint : reference_state.getRobotModel()->getActiveJointModels())
+  {
+    if (jmg.hasJointModel(joint->getName()))
+      continue;
+    hashCombine(hash, joint->getName());
+    const double* values = reference_state.getJointPositions(joint);
+    for (std::size_t i = 0; i < joint->getVariableCount(); ++i)
+      hashCombine(hash, values[i]);
+  }
+  return hash;
+}
+}  // namespace
+
+SelfCollisionPairCache::SelfCollisionPairCache(const std::string& group_name) : group_name_(group_name)
+{
+}
+
+bool SelfCollisionPairCache::compute(const planning_scene::PlanningScene& scene,
+                                     const moveit::core::RobotState& reference_state, std::size_t num_samples,
+                                     boost::uint32_t seed)
+{
+  const moveit::core::RobotModelConstPtr& robot_model = scene.getRobotModel();
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(group_name_);
+  if (!jmg || num_samples == 0)
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "Unable to sample self collisions of group " << group_name_);
+    return false;
+  }
+  // Candidates are the pairs that can change as the group moves and are not already allowed
+  const collision_detection::AllowedCollisionMatrix& acm = scene.getAllowedCollisionMatrix();
+  robot_name_ = robot_model->getName();
+  num_samples_ = num_samples;
+  seed_ = seed;
+  acm_hash_ = hashAllowedCollisions(*robot_model, acm);
+  reference_hash_ = hashReferenceValues(*jmg, reference_state);
+  always_pairs_.clear();
+  never_pairs_.clear();
+
+  const std::vector<const moveit::core::LinkModel*>& links = robot_model->getLinkModelsWithCollisionGeometry();
+  std::vector<const moveit::core::JointModel*> parents;
+  for (const moveit::core::LinkModel* link : links)
+    parents.push_back(getGroupParentJoint(link, jmg));
+
+  std::map<LinkPair, std::size_t> num_collisions;
+  for (std::size_t i = 0; i < links.size(); ++i)
+    for (std::size_t j = i + 1; j < links.size(); ++j)
+    {
+      if (parents[i] == parents[j])
+        continue;
+      collision_detection::AllowedCollision::Type type;
+      if (acm.getEntry(links[i]->getName(), links[j]->getName(), type) &&
+          type == collision_detection::AllowedCollision::ALWAYS)
+        continue;
+      num_collisions[LinkPair(std::min(links[i]->getName(), links[j]->getName()),
+                              std::max(links[i]->getName(), links[j]->getName()))] = 0;
+    }
+
+  // One contact per pair is enough to know it collided
+  collision_detection::CollisionRequest request;
+  request.contacts = true;
+  request.max_contacts = num_collisions.size();
+  request.max_contacts_per_pair = 1;
+
+  random_numbers::RandomNumberGenerator rng(seed);
+  moveit::core::RobotState robot_state(reference_state);
+  for (std::size_t sample = 0; sample < num_samples; ++sample)
+  {
+    robot_state.setToRandomPositions(jmg, rng);
+    robot_state.update();
+
+    collision_detection::CollisionResult result;
+    scene.getCollisionRobotUnpadded()->checkSelfCollision(request, result, robot_state, acm);
+    for (const auto& contact : result.contacts)
+    {
+      const LinkPair pair(std::min(contact.first.first, contact.first.second),
+                          std::max(contact.first.first, contact.first.second));
+      std::map<LinkPair, std::size_t>::iterator it = num_collisions.find(pair);
+      if (it != num_collisions.end())
+        it->second++;
+    }
+  }
+
+  for (const auto& pair : num_collisions)
+  {
+    if (pair.second == num_samples)
+      always_pairs_.push_back(pair.first);
+    else if (pair.second == 0)
+      never_pairs_.push_back(pair.first);
+  }
+
+  ROS_INFO_STREAM_NAMED(name_, "Sampled " << num_samples << " states of " << group_name_ << ": of "
+                                          << num_collisions.size() << " self collision pairs, "
+                                          << always_pairs_.size() << " always and " << never_pairs_.size()
+                                          << " never collide");
+  return true;
+}
+
+bool SelfCollisionPairCache::save(const std::string& file_path) const
+{
+  std::ofstream output(file_path.c_str());
+  if (!output)
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "Unable to write self collision pairs to " << file_path);
+    return false;
+  }
+
+  output << robot_name_ << " " << group_name_ << " " << num_samples_ << " " << seed_ << " " << acm_hash_ << " "
+         << reference_hash_ << std::endl;
+  for (const LinkPair& pair : always_pairs_)
+    output << "always " << pair.first << " " << pair.second << std::endl;
+  for (const LinkPair& pair : never_pairs_)
+    output << "never " << pair.first << " " << pair.second << std::endl;
+  return true;
+}
+
+bool SelfCollisionPairCache::load(const std::string& file_path, const planning_scene::PlanningScene& scene,
+                                  const moveit::core::RobotState& reference_state, std::size_t num_samples,
+                                  boost::uint32_t seed)
+{
+  const moveit::core::RobotModelConstPtr& robot_model = scene.getRobotModel();
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(group_name_);
+  std::ifstream input(file_path.c_str());
+  if (!jmg || !input)
+    return false;
+
+  std::string robot_name, group_name;
+  std::size_t file_num_samples;
+  boost::uint32_t file_seed;
+  boost::uint64_t file_acm_hash, file_reference_hash;
+  if (!(input >> robot_name >> group_name >> file_num_samples >> file_seed >> file_acm_hash >> file_reference_hash) ||
+      robot_name != robot_model->getName() || group_name != group_name_)
+  {
+    ROS_WARN_STREAM_NAMED(name_, "Self collision pairs in " << file_path << " are not for " << group_name_
+                                                            << ", ignoring them");
+    return false;
+  }
+
+  // Pairs sampled with fewer states are less certain, and pairs sampled with other allowed collisions, e.g. after
+  // the SRDF changed, or with the joints outside the group elsewhere may now be wrong
+  const boost::uint64_t acm_hash = hashAllowedCollisions(*robot_model, scene.getAllowedCollisionMatrix());
+  const boost::uint64_t reference_hash = hashReferenceValues(*jmg, reference_state);
+  if (file_num_samples != num_samples || file_seed != seed || file_acm_hash != acm_hash ||
+      file_reference_hash != reference_hash)
+  {
+    ROS_INFO_STREAM_NAMED(name_, "Self collision pairs in " << file_path << " were sampled with other settings, "
+                                                                            "sampling again");
+    return false;
+  }
+
+  std::vector<LinkPair> always_pairs, never_pairs;
+  std::string kind;
+  LinkPair pair;
+  while (input >> kind >> pair.first >> pair.second)
+  {
+    // The robot may have changed since the file was written
+    if ((kind != "always" && kind != "never") || !robot_model->hasLinkModel(pair.first) ||
+        !robot_model->hasLinkModel(pair.second))
+    {
+      ROS_WARN_STREAM_NAMED(name_, "Self collision pairs in " << file_path << " do not match the robot, "
+                                                                              "ignoring them");
+      return false;
+    }
+    (kind == "always" ? always_pairs : never_pairs).push_back(pair);
+  }
+
+  robot_name_ = robot_name;
+  num_samples_ = num_samples;
+  seed_ = seed;
+  acm_hash_ = acm_hash;
+  reference_hash_ = reference_hash;
+  always_pairs_.swap(always_pairs);
+  never_pairs_.swap(never_pairs);
+
+  ROS_INFO_STREAM_NAMED(name_, "Loaded " << always_pairs_.size() << " always and " << never_pairs_.size()
+                                         << " never colliding pairs of " << group_name_ << " from " << file_path);
+  return true;
+}
+
+std::size_t SelfCollisionPairCache::apply(collision_detection::AllowedCollisionMatrix& acm) const
+{
+  for (const LinkPair& pair : always_pairs_)
+    acm.setEntry(pair.first, pair.second, true);
+  for (const LinkPair& pair : never_pairs_)
+    acm.setEntry(pair.first, pair.second, true);
+  return always_pairs_.size() + never_pairs_.size();
+}
+
+}  // namespace curie_demos
@@ -0,0 +1,287 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Background service that keeps a lock-free buffer of valid robot states topped up
+*/
+
+// C++
+#include <algorithm>
+#include <chrono>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/state_reservoir.h>
+#include <curie_demos/random_streams.h>
+#include <curie_demos/metrics.h>
+
+namespace curie_demos
+{
+StateReservoir::StateReservoir(moveit_ompl::ModelBasedStateSpacePtr space,
+                               planning_scene::PlanningSceneConstPtr planning_scene,
+                               const moveit::core::RobotState &robot_state, boost::uint32_t master_seed,
+                               const std::string &group_name, bool checking_enabled, std::size_t num_threads,
+                               std::size_t num_streams, std::size_t stream_capacity)
+  : space_(space), jmg_(space->getJointModelGroup()), robot_state_(robot_state), values_(jmg_->getVariableCount())
+{
+  num_streams = std::max<std::size_t>(1, num_streams);
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = std::min(num_threads, num_streams);  // extra threads would have no stream to fill
+
+  // Streams are created in a fixed order on this thread, so their seeds do not depend on scheduling
+  const std::size_t batch_size = 32;
+  for (std::size_t i = 0; i < num_streams; ++i)
+  {
+    BatchStateSamplerPtr sampler(new BatchStateSampler(space, planning_scene, robot_state,
+                                                       deriveStreamSeed(master_seed, i), group_name, batch_size));
+    sampler->setCheckingEnabled(checking_enabled);
+    sampler->setVerbose(false);  // failures are retried and reported by the producers
+    samplers_.push_back(sampler);
+    buffers_.push_back(StateRingBufferPtr(new StateRingBuffer(stream_capacity, values_.size())));
+    exhausted_.push_back(boost::shared_ptr<std::atomic<bool> >(new std::atomic<bool>(false)));
+  }
+
+  for (std::size_t i = 0; i < num_threads; ++i)
+    threads_.push_back(std::thread(&StateReservoir::produce, this, i, num_threads));
+
+  ROS_INFO_STREAM_NAMED(name_, "Filling " << num_streams << " streams of valid states using " << num_threads
+                                          << " threads");
+}
+
+StateReservoir::~StateReservoir()
+{
+  stop();
+}
+
+void StateReservoir::stop()
+{
+  stop_ = true;
+  notify(produced_);
+  notify(consumed_);
+  for (std::thread &thread : threads_)
+    if (thread.joinable())
+      thread.join();
+}
+
+bool StateReservoir::take(double *values)
+{
+  std::lock_guard<std::mutex> lock(take_mutex_);
+  return takeLocked(values);
+}
+
+bool StateReservoir::takeLocked(double *values)
+{
+  static MetricCounter &hits =
+      Metrics::getCounter("curie_demos_reservoir_hits_total", "States taken from the reservoir without waiting");
+  static MetricCounter &misses =
+      Metrics::getCounter("curie_demos_reservoir_misses_total", "States that had to wait for a producer");
+
+  const std::size_t num_streams = buffers_.size();
+  std::size_t num_exhausted = 0;
+  bool waited = false;
+  while (num_exhausted < num_streams)
+  {
+    StateRingBuffer &buffer = *buffers_[next_stream_];
+    if (buffer.pop(values))
+    {
+      notify(consumed_);
+      next_stream_ = (next_stream_ + 1) % num_streams;
+      (waited ? misses : hits).increment();
+      return true;
+    }
+
+    // Only skip a stream once its producer has given up or been stopped, otherwise wait so the order stays fixed
+    std::atomic<bool> &exhausted = *exhausted_[next_stream_];
+    if ((exhausted || stop_) && buffer.size() == 0)
+    {
+      next_stream_ = (next_stream_ + 1) % num_streams;
+      num_exhausted++;
+      continue;
+    }
+    num_exhausted = 0;
+    waited = true;
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    produced_.wait(lock, [&]()
+                   {
+                     return buffer.size() > 0 || exhausted || stop_;
+                   });
+  }
+
+  ROS_ERROR_STREAM_NAMED(name_, "Unable to find any more valid random states");
+  return false;
+}
+
+bool StateReservoir::take(moveit::core::RobotState &robot_state)
+{
+  std::lock_guard<std::mutex> lock(take_mutex_);
+  if (!takeLocked(&values_[0]))
+    return false;
+
+  robot_state.setJointGroupPositions(jmg_, values_);
+  robot_state.update();
+  return true;
+}
+
+bool StateReservoir::take(ompl::base::State *state)
+{
+  std::lock_guard<std::mutex> lock(take_mutex_);
+  if (!takeLocked(&values_[0]))
+    return false;
+
+  // Only the joint values are copied, no transforms are needed
+  robot_state_.setJointGroupPositions(jmg_, values_);
+  space_->copyToOMPLState(state, robot_state_);
+  return true;
+}
+
+std::size_t StateReservoir::size() const
+{
+  std::size_t total = 0;
+  for (const StateRingBufferPtr &buffer : buffers_)
+    total += buffer->size();
+  return total;
+}
+
+void StateReservoir::produce(std::size_t thread_id, std::size_t num_threads)
+{
+  try
+  {
+    produceStreams(thread_id, num_threads);
+  }
+  catch (const std::exception &e)
+  {
+    ROS_ERROR_STREAM_NAMED(name_, "Producer thread " << thread_id << " failed: " << e.what());
+  }
+
+  // Consumers must not wait on streams nobody fills
+  for (std::size_t stream_id = thread_id; stream_id < buffers_.size(); stream_id += num_threads)
+    setExhausted(stream_id);
+}
+
+void StateReservoir::setExhausted(std::size_t stream_id)
+{
+  *exhausted_[stream_id] = true;
+  notify(produced_);
+}
+
+void StateReservoir::notify(std::condition_variable &condition)
+{
+  std::lock_guard<std::mutex> lock(wake_mutex_);
+  condition.notify_all();
+}
+
+void StateReservoir::produceStreams(std::size_t thread_id, std::size_t num_threads)
+{
+  typedef std::chrono::steady_clock Clock;
+  const std::chrono::milliseconds min_backoff(1);
+  const std::chrono::milliseconds max_backoff(100);
+
+  // Failures in a row and when to try again, for the streams of this thread
+  std::vector<std::size_t> failed_attempts(buffers_.size(), 0);
+  std::vector<Clock::time_point> retry_time(buffers_.size());
+
+  std::vector<double> values(values_.size());
+  while (!stop_)
+  {
+    // Streams are dealt to the threads round robin, top each one up by a single state per pass
+    bool all_idle = true;
+    const Clock::time_point now = Clock::now();
+    for (std::size_t stream_id = thread_id; stream_id < buffers_.size() && !stop_; stream_id += num_threads)
+    {
+      StateRingBuffer &buffer = *buffers_[stream_id];
+      if (*exhausted_[stream_id] || buffer.full() || now < retry_time[stream_id])
+        continue;
+      all_idle = false;
+
+      if (samplers_[stream_id]->sample(&values[0]))
+      {
+        failed_attempts[stream_id] = 0;
+        buffer.push(&values[0]);
+        notify(produced_);
+        continue;
+      }
+
+      // Back off exponentially rather than starving the other streams, until the budget is spent
+      const std::size_t failures = ++failed_attempts[stream_id];
+      const std::size_t max_failures = max_failed_attempts_;
+      if (max_failures > 0 && failures >= max_failures)
+      {
+        ROS_ERROR_STREAM_NAMED(name_, "Giving up on stream " << stream_id << " after " << failures
+                                                             << " failed attempts to find a valid state");
+        setExhausted(stream_id);
+        continue;
+      }
+      retry_time[stream_id] = now + std::min<std::chrono::milliseconds>(
+                                        max_backoff, min_backoff * (1 << std::min<std::size_t>(failures - 1, 7)));
+      ROS_WARN_STREAM_THROTTLE_NAMED(5, name_, "Stream " << stream_id << " failed " << failures
+                                                         << " times in a row to find a valid state, retrying");
+    }
+
+    if (!all_idle)
+      continue;
+
+    // Nothing to do until a consumer takes something or a backoff ends
+    bool backing_off = false;
+    Clock::time_point wake_time = Clock::time_point::max();
+    for (std::size_t stream_id = thread_id; stream_id < buffers_.size(); stream_id += num_threads)
+      if (!*exhausted_[stream_id] && retry_time[stream_id] > now)
+      {
+        backing_off = true;
+        wake_time = std::min(wake_time, retry_time[stream_id]);
+      }
+
+    const auto has_work = [&]()
+    {
+      if (stop_)
+        return true;
+      const Clock::time_point time = Clock::now();
+      for (std::size_t stream_id = thread_id; stream_id < buffers_.size(); stream_id += num_threads)
+        if (!*exhausted_[stream_id] && !buffers_[stream_id]->full() && time >= retry_time[stream_id])
+          return true;
+      return false;
+    };
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    if (backing_off)
+      consumed_.wait_until(lock, wake_time, has_work);
+    else
+      consumed_.wait(lock, has_work);
+  }
+}
+
+}  // namespace curie_demos
@@ -38,6 +38,7 @@
 #include <ompl/base/SpaceInformation.h>
 #include <ros/ros.h>
 #include <moveit_ompl/detail/threadsafe_state_storage.h>
+#include <curie_demos/metrics.h>
 
 moveit_ompl::StateValidityChecker::StateValidityChecker(const std::string &group_name,
                                                         ompl::base::SpaceInformationPtr &si,
@@ -78,6 +79,8 @@ void moveit_ompl::StateValidityChecker::setVerbose(bool flag)
 
 bool moveit_ompl::StateValidityChecker::isValid(const ompl::base::State *state, bool verbose) const
 {
+  curie_demos::Metrics::getValidityChecksCounter().increment();
+
   // check bounds
   if (!si_->satisfiesBounds(state))
   {
@@ -116,11 +119,15 @@ bool moveit_ompl::StateValidityChecker::isValid(const ompl::base::State *state,
     planning_scene_->checkCollision(collision_request_simple_, res, *robot_state);
   }
 
+  if (res.collision)
+    curie_demos::Metrics::getValidityCollisionsCounter().increment();
   return res.collision == false;
 }
 
 bool moveit_ompl::StateValidityChecker::isValid(const ompl::base::State *state, double &dist, bool verbose) const
 {
+  curie_demos::Metrics::getValidityChecksCounter().increment();
+
   if (!si_->satisfiesBounds(state))
   {
     if (verbose)
@@ -170,6 +177,8 @@ bool moveit_ompl::StateValidityChecker::isValid(const ompl::base::State *state,
   //   visual_->viz2()->state(state, ompl::tools::SMALL, ompl::tools::GREEN, 0);
   // visual_->viz2()->trigger();
 
+  if (res.collision)
+    curie_demos::Metrics::getValidityCollisionsCounter().increment();
   return res.collision == false;
 }
 
@@ -1,15 +1,35 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
 #include <string>
 #include <vector>
-#include <iostream>
-#include <fstream>
+#include <sys/wait.h>
 #include <unistd.h>
 
 // this package
-#include <curie_demos/process_mem_usage.h>
+#include <curie_demos/memory_usage.h>
+#include <curie_demos/roadmap_state_store.h>
 
-const std::size_t ARRAY_SIZE = 12;
+/**
+ * Usage: memory_demo [num_states] [dimensions] [num_queries]
+ *
+ * Builds a roadmap sized store of random states with each allocation strategy, in its own process so every
+ * strategy starts from the same heap, and reports:
+ *   bytes/state - RSS growth while building, divided by the number of states
+ *   build       - time to copy all states in
+ *   scan        - states per second of a brute force nearest neighbor search
+ *   freed       - RSS growth still held after the store is destroyed, i.e. kept by the allocator
+ * Quantized stores also report the largest observed distance error against getDistanceErrorBound()
+ */
 
+// How OMPL keeps a real vector state: one allocation for the state and one for its values
 class StateType
 {
 public:
@@ -19,102 +39,276 @@ public:
   double *values;
 };
 
-int main(int argc, char **argv)
+double squaredDistance(const double *a, const double *b, std::size_t dim)
 {
-  double vm, rss;
+  double squared = 0.0;
+  for (std::size_t j = 0; j < dim; ++j)
+    squared += (a[j] - b[j]) * (a[j] - b[j]);
+  return squared;
+}
 
-  double array_size_b = ARRAY_SIZE * sizeof(double);  // bytes
-  double state_size_b = sizeof(StateType);            // bytes
+/** \brief A new state and a new array of values for every state */
+class PerStateNew
+{
+public:
+  PerStateNew(std::size_t dim) : dim_(dim)
+  {
+  }
 
-  std::cout << "Size of state: " << state_size_b << " bytes" << std::endl;
-  std::cout << "Size of double: " << sizeof(double) << " bytes" << std::endl;
-  std::cout << "Size of int: " << sizeof(int) << " bytes" << std::endl;
-  std::cout << "Size of short int: " << sizeof(short int) << " bytes" << std::endl;
-  std::cout << "Size of short: " << sizeof(short) << " bytes" << std::endl;
-  std::cout << "Size of 12 doubles: " << array_size_b << " bytes" << std::endl;
-  std::cout << "Total size: " << array_size_b + state_size_b << " bytes" << std::endl;
-  return 0;
+  ~PerStateNew()
+  {
+    for (StateType *state : states_)
+    {
+      delete[] state->values;
+      delete state;
+    }
+  }
 
-  // Get computer's base measure of memory usage
-  processMemUsage(vm, rss);
+  void addState(const double *values)
+  {
+    states_.push_back(new StateType());
+    states_.back()->values = new double[dim_];
+    std::copy(values, values + dim_, states_.back()->values);
+  }
 
-  // On first loop, add base memory
-  double my_count_mb = vm;
+  double nearest(const double *query) const
+  {
+    double best = std::numeric_limits<double>::infinity();
+    for (const StateType *state : states_)
+      best = std::min(best, squaredDistance(state->values, query, dim_));
+    return std::sqrt(best);
+  }
 
-  std::vector<StateType *> states;
+private:
+  std::size_t dim_;
+  std::vector<StateType *> states_;
+};
 
-  // Load memory
-  while (vm < 1000.0)
+/** \brief Still a state object pointing at its values, but both carved from large chunks */
+class PooledStates
+{
+public:
+  PooledStates(std::size_t dim, std::size_t chunk_states = 65536) : dim_(dim), chunk_states_(chunk_states)
   {
-    states.push_back(new StateType());
-    states.back()->values = new double[ARRAY_SIZE];
+  }
 
-    // Populate with dummy data
-    for (std::size_t i = 0; i < ARRAY_SIZE; ++i)
+  void addState(const double *values)
+  {
+    if (num_states_ % chunk_states_ == 0)
     {
-      states.back()->values[i] = i;
+      state_chunks_.emplace_back(new StateType[chunk_states_]);
+      value_chunks_.emplace_back(new double[chunk_states_ * dim_]);
     }
 
-    // My count
-    my_count_mb += (array_size_b + state_size_b) / 1048576.0;  // convert byte to megabyte
+    StateType &state = state_chunks_.back()[num_states_ % chunk_states_];
+    state.values = value_chunks_.back().get() + (num_states_ % chunk_states_) * dim_;
+    std::copy(values, values + dim_, state.values);
+    states_.push_back(&state);
+    num_states_++;
+  }
+
+  double nearest(const double *query) const
+  {
+    double best = std::numeric_limits<double>::infinity();
+    for (const StateType *state : states_)
+      best = std::min(best, squaredDistance(state->values, query, dim_));
+    return std::sqrt(best);
+  }
 
-    // Get computer's measure of memory usage
-    processMemUsage(vm, rss);
+private:
+  std::size_t dim_;
+  std::size_t chunk_states_;
+  std::size_t num_states_ = 0;
+  std::vector<std::unique_ptr<StateType[]>> state_chunks_;
+  std::vector<std::unique_ptr<double[]>> value_chunks_;
+  std::vector<StateType *> states_;
+};
 
-    // Output
-    // std::cout << "VM: " << vm << " MB    |    my_count: " << my_count_mb << " MB" << std::endl;
-    std::cout << "VM: " << vm << " MB \t RSS: " << rss << " MB" << std::endl;
+/** \brief One array per joint, so a scan streams each joint across all states */
+class SoASlab
+{
+public:
+  SoASlab(std::size_t dim) : joints_(dim)
+  {
   }
 
-  // Unload array
-  for (std::size_t i = 0; i < states.size(); ++i)
+  void addState(const double *values)
   {
-    // Unload memory
-    delete[] states[i]->values;
+    for (std::size_t j = 0; j < joints_.size(); ++j)
+      joints_[j].push_back(values[j]);
+  }
 
-    // My count
-    my_count_mb -= (array_size_b) / 1048576.0;  // convert byte to megabyte
+  double nearest(const double *query) const
+  {
+    const std::size_t num_states = joints_.front().size();
+    squared_.assign(num_states, 0.0);
+    for (std::size_t j = 0; j < joints_.size(); ++j)
+    {
+      const double *joint = joints_[j].data();
+      for (std::size_t i = 0; i < num_states; ++i)
+        squared_[i] += (joint[i] - query[j]) * (joint[i] - query[j]);
+    }
+    return std::sqrt(*std::min_element(squared_.begin(), squared_.end()));
+  }
 
-    // Get computer's measure of memory usage
-    processMemUsage(vm, rss);
+private:
+  std::vector<std::vector<double>> joints_;
+  mutable std::vector<double> squared_;
+};
 
-    // Output
-    // std::cout << "VM: " << vm << " MB    |    my_count: " << my_count_mb << " MB" << std::endl;
-    std::cout << "VM: " << vm << " MB \t RSS: " << rss << " MB" << std::endl;
+/** \brief Row-major slabs of this package, exact or quantized */
+class StoreStates
+{
+public:
+  StoreStates(std::size_t dim, curie_demos::StateStorageType type)
+    : store_(std::vector<double>(dim, -M_PI), std::vector<double>(dim, M_PI), type)
+  {
   }
 
-  std::cout << "-------------------------------------------------------" << std::endl;
-  std::cout << "-------------------------------------------------------" << std::endl;
-  std::cout << "-------------------------------------------------------" << std::endl;
-  // usleep(10000000);
+  void addState(const double *values)
+  {
+    store_.addState(values);
+  }
+
+  double nearest(const double *query) const
+  {
+    double best = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < store_.size(); ++i)
+      best = std::min(best, store_.distance(i, query));
+    return best;
+  }
 
-  /*
-  // Unload state
-  for (std::size_t i = 0; i < states.size(); ++i)
+  const curie_demos::RoadmapStateStore &getStore() const
   {
-    // Unload memory
-    delete[] states[i]->values;
-    delete states[i];
+    return store_;
+  }
 
-    // My count
-    my_count_mb -= (state_size_b + array_size_b) / 1048576.0; // convert byte to megabyte
+private:
+  curie_demos::RoadmapStateStore store_;
+};
 
-    // Get computer's measure of memory usage
-    processMemUsage(vm, rss);
+double getRSS()
+{
+  double vm, rss;
+  curie_demos::getMemoryUsage(vm, rss);
+  return rss;
+}
 
-    // Output
-    std::cout << "VM: " << vm << " MB    |    my_count: " << my_count_mb << " MB" << std::endl;
+double getSeconds(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** \brief Strategies other than the store keep exact values, nothing to check */
+template <class Strategy>
+std::string checkDistanceError(const Strategy &, const std::vector<double> &, std::size_t)
+{
+  return "";
+}
+
+/** \brief Compare the stored distance of neighboring states with the exact distance */
+std::string checkDistanceError(const StoreStates &states, const std::vector<double> &values, std::size_t dim)
+{
+  const curie_demos::RoadmapStateStore &store = states.getStore();
+  double max_error = 0.0;
+  for (std::size_t i = 1; i < store.size(); i += 97)
+  {
+    const double exact = std::sqrt(squaredDistance(&values[i * dim], &values[(i - 1) * dim], dim));
+    max_error = std::max(max_error, std::abs(store.distance(i, i - 1) - exact));
   }
-  */
 
-  while (true)
+  const double bound = store.getDistanceErrorBound();
+  std::ostringstream report;
+  report << "  distance error: " << std::scientific << std::setprecision(3) << max_error << " observed, " << bound
+         << " bound" << (max_error <= bound ? "" : " - EXCEEDED") << std::endl;
+  return report.str();
+}
+
+/** \brief Measure one strategy in a child process and print its row */
+template <class Strategy, class... Args>
+void runStrategy(const std::string &name, const std::vector<double> &values, const std::vector<double> &queries,
+                 std::size_t dim, Args... args)
+{
+  std::cout.flush();
+  const pid_t pid = fork();
+  if (pid < 0)
   {
-    processMemUsage(vm, rss);
-    std::cout << "VM: " << vm << " MB \t RSS: " << rss << " MB" << std::endl;
-    // std::cout << "Memory usage: " << getValue() << " KB" << std::endl;
+    std::cerr << "Unable to fork for " << name << std::endl;
+    return;
+  }
+  if (pid > 0)
+  {
+    waitpid(pid, nullptr, 0);
+    return;
+  }
+
+  const std::size_t num_states = values.size() / dim;
+  const std::size_t num_queries = queries.size() / dim;
+  const double rss_begin = getRSS();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::unique_ptr<Strategy> states(new Strategy(dim, args...));
+  for (std::size_t i = 0; i < num_states; ++i)
+    states->addState(&values[i * dim]);
+  const double build_time = getSeconds(start);
+  const double rss_built = getRSS();
+
+  // Use the results so the scan is not optimized away
+  double checksum = 0.0;
+  start = std::chrono::steady_clock::now();
+  for (std::size_t q = 0; q < num_queries; ++q)
+    checksum += states->nearest(&queries[q * dim]);
+  const double scan_time = getSeconds(start);
+
+  const std::string error_report = checkDistanceError(*states, values, dim);
+
+  states.reset();
+  const double rss_freed = getRSS();
 
-    usleep(1000000);
+  std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1) << std::setw(12)
+            << (rss_built - rss_begin) * 1048576.0 / num_states << std::setprecision(3) << std::setw(10) << build_time
+            << std::setprecision(1) << std::setw(12) << num_states * num_queries / scan_time / 1e6 << std::setw(12)
+            << rss_freed - rss_begin << std::setprecision(6) << std::setw(14) << checksum / num_queries << std::endl;
+  std::cout << error_report;
+  std::cout.flush();
+  _exit(0);
+}
+
+int main(int argc, char **argv)
+{
+  const std::size_t num_states = argc > 1 ? std::stoul(argv[1]) : 2000000;
+  const std::size_t dim = argc > 2 ? std::stoul(argv[2]) : 12;
+  const std::size_t num_queries = argc > 3 ? std::stoul(argv[3]) : 10;
+  if (num_states == 0 || dim == 0 || num_queries == 0)
+  {
+    std::cerr << "Usage: memory_demo [num_states] [dimensions] [num_queries]" << std::endl;
+    return 1;
   }
 
+  std::cout << "Storing " << num_states << " states of " << dim << " joints, " << num_queries << " queries"
+            << std::endl;
+  std::cout << "Raw values: " << dim * sizeof(double) << " bytes per state" << std::endl;
+
+  // Same values for every strategy
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> uniform(-M_PI, M_PI);
+  std::vector<double> values(num_states * dim);
+  for (double &value : values)
+    value = uniform(generator);
+  std::vector<double> queries(num_queries * dim);
+  for (double &value : queries)
+    value = uniform(generator);
+
+  std::cout << std::left << std::setw(16) << "strategy" << std::right << std::setw(12) << "bytes/state"
+            << std::setw(10) << "build s" << std::setw(12) << "scan M/s" << std::setw(12) << "freed MB"
+            << std::setw(14) << "mean nearest" << std::endl;
+
+  runStrategy<PerStateNew>("new per state", values, queries, dim);
+  runStrategy<PooledStates>("pooled", values, queries, dim);
+  runStrategy<SoASlab>("soa slab", values, queries, dim);
+  runStrategy<StoreStates>("store double", values, queries, dim, curie_demos::STORAGE_DOUBLE);
+  runStrategy<StoreStates>("store float", values, queries, dim, curie_demos::STORAGE_FLOAT);
+  runStrategy<StoreStates>("store fixed16", values, queries, dim, curie_demos::STORAGE_FIXED16);
+
   return 0;
 }
@@ -0,0 +1,254 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Throughput of the state validity checker on the Hilgendorf scene, single and multi threaded
+*/
+
+// C++
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <thread>
+
+// ROS
+#include <ros/ros.h>
+
+// OMPL
+#include <ompl/base/SpaceInformation.h>
+
+// Random
+#include <random_numbers/random_numbers.h>
+
+// this package
+#include <curie_demos/moveit_base.h>
+#include <curie_demos/state_validity_checker.h>
+#include <curie_demos/collision_scene.h>
+#include <curie_demos/random_streams.h>
+
+namespace ob = ompl::base;
+
+namespace curie_demos
+{
+class ValidityCheckerBenchmark : public MoveItBase
+{
+public:
+  /** \brief Constructor */
+  ValidityCheckerBenchmark() : nh_("~")
+  {
+    std::string planning_group_name;
+    bool freeze_planning_scene;
+    bool filter_collision_pairs;
+    int self_collision_samples;
+    int num_states;
+    int max_threads;
+    int seed;
+
+    // Scene settings are shared with the demo so the same checks are measured
+    std::size_t error = 0;
+    ros::NodeHandle demo_nh(nh_, "curie_demos");
+    error += !rosparam_shortcuts::get(name_, demo_nh, "planning_group_name", planning_group_name);
+    error += !rosparam_shortcuts::get(name_, demo_nh, "freeze_planning_scene", freeze_planning_scene);
+    error += !rosparam_shortcuts::get(name_, demo_nh, "filter_collision_pairs", filter_collision_pairs);
+    error += !rosparam_shortcuts::get(name_, demo_nh, "self_collision_samples", self_collision_samples);
+    ros::NodeHandle rpnh(nh_, name_);
+    error += !rosparam_shortcuts::get(name_, rpnh, "num_states", num_states);
+    error += !rosparam_shortcuts::get(name_, rpnh, "max_threads", max_threads);
+    error += !rosparam_shortcuts::get(name_, rpnh, "seed", seed);
+    rosparam_shortcuts::shutdownIfError(name_, error);
+
+    num_states_ = std::max(1, num_states);
+    max_threads_ = max_threads > 0 ? max_threads : std::max(1u, std::thread::hardware_concurrency());
+    const boost::uint32_t master_seed = std::max(1, seed);
+
+    // The checker threads read the scene without the monitor's lock, which is only safe on a frozen copy
+    if (!freeze_planning_scene && max_threads_ > 1)
+    {
+      ROS_WARN_STREAM_NAMED(name_, "Multithreaded checks require freeze_planning_scene, freezing the planning scene");
+      freeze_planning_scene = true;
+    }
+
+    // Robot and scene
+    MoveItBase::init(nh_);
+    jmg_ = robot_model_->getJointModelGroup(planning_group_name);
+    if (!jmg_)
+    {
+      ROS_ERROR_STREAM_NAMED(name_, "Unknown planning group " << planning_group_name);
+      exit(-1);
+    }
+    collision_scene_ =
+        createCollisionScene(planning_scene_monitor_, planning_group_name, *current_state_, freeze_planning_scene,
+                             filter_collision_pairs, std::max(0, self_collision_samples),
+                             deriveStreamSeed(master_seed, 3));
+
+    // Same checker as the demo
+    moveit_ompl::ModelBasedStateSpaceSpecification mbss_spec(robot_model_, jmg_);
+    space_.reset(new moveit_ompl::ModelBasedStateSpace(mbss_spec));
+    si_.reset(new ob::SpaceInformation(space_));
+    validity_checker_ =
+        new moveit_ompl::StateValidityChecker(planning_group_name, si_, *current_state_, collision_scene_, space_);
+    si_->setStateValidityChecker(ob::StateValidityCheckerPtr(validity_checker_));
+    si_->setup();
+
+    // The fixed set of states replayed through every check
+    random_numbers::RandomNumberGenerator rng(deriveStreamSeed(master_seed, 0));
+    moveit::core::RobotState robot_state(*current_state_);
+    for (std::size_t i = 0; i < num_states_; ++i)
+    {
+      robot_state.setToRandomPositions(jmg_, rng);
+      states_.push_back(space_->allocState());
+      space_->copyToOMPLState(states_.back(), robot_state);
+    }
+
+    ROS_INFO_STREAM_NAMED(name_, "Benchmarking " << planning_group_name << " with " << num_states_
+                                                 << " states, frozen scene: " << freeze_planning_scene
+                                                 << ", filtered pairs: " << filter_collision_pairs
+                                                 << ", self collision samples: " << self_collision_samples);
+  }
+
+  /** \brief Destructor */
+  ~ValidityCheckerBenchmark()
+  {
+    for (ob::State* state : states_)
+      space_->freeState(state);
+  }
+
+  /** \brief Time every check with 1, 2, 4, ... max_threads threads */
+  void run()
+  {
+    std::cout << std::left << std::setw(16) << "check" << std::right << std::setw(9) << "threads" << std::setw(14)
+              << "checks/s" << std::setw(10) << "speedup" << std::setw(10) << "valid %" << std::endl;
+
+    const moveit_ompl::StateValidityChecker* checker = validity_checker_;
+    benchmark("isValid", [checker](const ob::State* state)
+              {
+                return checker->isValid(state);
+              });
+    benchmark("isValid(dist)", [checker](const ob::State* state)
+              {
+                double dist;
+                return checker->isValid(state, dist);
+              });
+    benchmark("cost", [checker](const ob::State* state)
+              {
+                checker->cost(state);
+                return true;
+              });
+    benchmark("clearance", [checker](const ob::State* state)
+              {
+                return checker->clearance(state) > 0.0;
+              });
+  }
+
+private:
+  /** \brief Check every state once per thread count, the threads splitting the states between them */
+  void benchmark(const std::string& check_name, const std::function<bool(const ob::State*)>& check)
+  {
+    // Powers of two, always including the largest thread count
+    std::vector<std::size_t> thread_counts;
+    for (std::size_t num_threads = 1; num_threads < max_threads_; num_threads *= 2)
+      thread_counts.push_back(num_threads);
+    thread_counts.push_back(max_threads_);
+
+    double single_thread_rate = 0.0;
+    for (std::size_t num_threads : thread_counts)
+    {
+      std::atomic<std::size_t> num_valid(0);
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      std::vector<std::thread> threads;
+      for (std::size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+        threads.push_back(std::thread([this, &check, &num_valid, thread_id, num_threads]()
+                                      {
+                                        std::size_t valid = 0;
+                                        for (std::size_t i = thread_id; i < states_.size(); i += num_threads)
+                                          valid += check(states_[i]);
+                                        num_valid += valid;
+                                      }));
+      for (std::thread& thread : threads)
+        thread.join();
+
+      const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      const double rate = states_.size() / duration;
+      if (num_threads == 1)
+        single_thread_rate = rate;
+
+      std::cout << std::left << std::setw(16) << check_name << std::right << std::setw(9) << num_threads << std::fixed
+                << std::setprecision(0) << std::setw(14) << rate << std::setprecision(2) << std::setw(10)
+                << rate / single_thread_rate << std::setprecision(1) << std::setw(10)
+                << 100.0 * num_valid / states_.size() << std::endl;
+    }
+  }
+
+  // A shared node handle
+  ros::NodeHandle nh_;
+
+  // The short name of this class
+  std::string name_ = "validity_checker_benchmark";
+
+  std::size_t num_states_;
+  std::size_t max_threads_;
+
+  moveit::core::JointModelGroup* jmg_;
+  planning_scene::PlanningSceneConstPtr collision_scene_;
+  moveit_ompl::ModelBasedStateSpacePtr space_;
+  ob::SpaceInformationPtr si_;
+  // Owned by si_
+  moveit_ompl::StateValidityChecker* validity_checker_;
+
+  std::vector<ob::State*> states_;
+};  // end class
+
+}  // namespace curie_demos
+
+int main(int argc, char** argv)
+{
+  // Initialize ROS
+  ros::init(argc, argv, "validity_checker_benchmark");
+  ROS_INFO_STREAM_NAMED("main", "Starting ValidityCheckerBenchmark...");
+
+  // Allow the planning scene monitor to recieve and send ros messages
+  ros::AsyncSpinner spinner(2);
+  spinner.start();
+
+  curie_demos::ValidityCheckerBenchmark benchmark;
+  benchmark.run();
+
+  // Shutdown
+  ROS_INFO_STREAM_NAMED("main", "Shutting down.");
+  ros::shutdown();
+
+  return 0;
+}
@@ -0,0 +1,230 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016, University of Colorado, Boulder
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Dave Coleman
+   Desc:   Scoped trace events of the major phases, buffered per thread and exported for chrome://tracing
+*/
+
+// C++
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+
+// ROS
+#include <ros/ros.h>
+
+// this package
+#include <curie_demos/trace.h>
+
+namespace curie_demos
+{
+namespace
+{
+struct TraceEvent
+{
+  const char* name_;
+  std::uint64_t begin_ns_;
+  std::uint64_t end_ns_;
+};
+
+// Bounds the memory of a long run, later events of a full buffer are dropped and counted
+const std::size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+struct ThreadBuffer
+{
+  // Row of the trace, shared by the threads that used this buffer one after another
+  std::size_t thread_id_;
+  // Owned by a running thread, guarded by buffers_mutex
+  bool in_use_ = true;
+  // Only contended while saving or clearing
+  std::mutex mutex_;
+  std::vector<TraceEvent> events_;
+  std::size_t num_dropped_ = 0;
+};
+
+std::atomic<bool> enabled(false);
+
+// Protects the list of buffers, which keeps the events of finished threads for saving. There are only as many
+// buffers as threads that recorded at the same time
+std::mutex buffers_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+/** \brief Gives the calling thread's buffer back when the thread exits */
+struct ThreadBufferHolder
+{
+  ~ThreadBufferHolder()
+  {
+    if (!buffer_)
+      return;
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer_->in_use_ = false;
+  }
+
+  ThreadBuffer* buffer_ = nullptr;
+};
+
+ThreadBuffer& getThreadBuffer()
+{
+  thread_local ThreadBufferHolder holder;
+  if (!holder.buffer_)
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers)
+      if (!buffer->in_use_)
+      {
+        buffer->in_use_ = true;
+        holder.buffer_ = buffer.get();
+        break;
+      }
+
+    if (!holder.buffer_)
+    {
+      buffers.push_back(std::make_shared<ThreadBuffer>());
+      holder.buffer_ = buffers.back().get();
+      holder.buffer_->thread_id_ = buffers.size();
+    }
+  }
+  return *holder.buffer_;
+}
+
+/** \brief Nanoseconds as microseconds, written without the rounding of a double */
+void writeMicroseconds(std::ostream& out, std::uint64_t ns)
+{
+  const char fraction[4] = { char('0' + ns / 100 % 10), char('0' + ns / 10 % 10), char('0' + ns % 10), '\0' };
+  out << ns / 1000 << "." << fraction;
+}
+
+void writeEscaped(std::ostream& out, const char* text)
+{
+  for (; *text; ++text)
+  {
+    if (*text == '"' || *text == '\\')
+      out << '\\';
+    out << *text;
+  }
+}
+}  // namespace
+
+void Tracer::setEnabled(bool enabled_in)
+{
+  enabled.store(enabled_in, std::memory_order_relaxed);
+}
+
+bool Tracer::isEnabled()
+{
+  return enabled.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Tracer::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::uint64_t Tracer::beginEvent()
+{
+  getThreadBuffer();
+  return now();
+}
+
+void Tracer::record(const char* name, std::uint64_t begin_ns, std::uint64_t end_ns)
+{
+  ThreadBuffer& buffer = getThreadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex_);
+  if (buffer.events_.size() < MAX_EVENTS_PER_THREAD)
+    buffer.events_.push_back(TraceEvent{ name, begin_ns, end_ns });
+  else
+    buffer.num_dropped_++;
+}
+
+bool Tracer::save(const std::string& file_path)
+{
+  std::ofstream out(file_path.c_str());
+  if (!out)
+  {
+    ROS_ERROR_STREAM_NAMED("trace", "Unable to write trace to " << file_path);
+    return false;
+  }
+
+  const int pid = getpid();
+  std::size_t num_events = 0;
+  std::size_t num_dropped = 0;
+  bool first = true;
+
+  // Complete events with microsecond timestamps, one row per thread
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+  for (const std::shared_ptr<ThreadBuffer>& buffer : buffers)
+  {
+    std::lock_guard<std::mutex> lock(buffer->mutex_);
+    for (const TraceEvent& event : buffer->events_)
+    {
+      out << (first ? "\n" : ",\n") << "{\"name\":\"";
+      writeEscaped(out, event.name_);
+      out << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->thread_id_
+          << ",\"ts\":";
+      writeMicroseconds(out, event.begin_ns_);
+      out << ",\"dur\":";
+      writeMicroseconds(out, event.end_ns_ - event.begin_ns_);
+      out << "}";
+      first = false;
+    }
+    num_events += buffer->events_.size();
+    num_dropped += buffer->num_dropped_;
+  }
+  out << "\n]}" << std::endl;
+
+  if (num_dropped)
+    ROS_WARN_STREAM_NAMED("trace", "Dropped " << num_dropped << " trace events from full buffers");
+  ROS_INFO_STREAM_NAMED("trace", "Saved " << num_events << " trace events from " << buffers.size() << " threads to "
+                                          << file_path);
+  return true;
+}
+
+void Tracer::clear()
+{
+  std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+  for (const std::shared_ptr<ThreadBuffer>& buffer : buffers)
+  {
+    std::lock_guard<std::mutex> lock(buffer->mutex_);
+    buffer->events_.clear();
+    buffer->num_dropped_ = 0;
+  }
+}
+
+}  // namespace curie_demos